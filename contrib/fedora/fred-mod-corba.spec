@@ -62,6 +62,7 @@ rm -rf ${RPM_BUILD_ROOT}
 %files -f INSTALLED_FILES
 %defattr(-,root,root,-)
 %{_libdir}/httpd/modules/mod_corba.so
+%{_includedir}/httpd/mod_corba.h
 /usr/share/fred-mod-corba/01-fred-mod-corba-apache.conf
 
 %changelog
@@ -71,10 +71,222 @@
  *         part is missing then default context 'fred' is assumed.
  *   .
  * 
- * CorbaNameservice and CorbaObject configuration values are in virtual servers
- * inherited from main server, which can be exploited to set these settings
- * just once for all servers. CorbaEnable must be enabled explicitly for each
- * virtual server - this directive is not inherited.
+ *   name: CorbaObjectContext
+ *   - value:        CONTEXTNAME.* [CONTEXTNAME.* ...]
+ *   - default:      none
+ *   - context:      global config, virtual host
+ *   - description:
+ *         All objects bound in the context are exported under the name they
+ *         are bound with (e.g. object 'EPP' of context 'fred' under alias
+ *         'EPP'). Objects are discovered by a single list() call when IOR
+ *         cache is filled, so newly bound objects appear on next fill
+ *         without reconfiguration. Explicitly configured CorbaObject with
+ *         the same alias takes precedence. The list of bindings is cached
+ *         once for all servers using the context, each server applies its
+ *         own CorbaObjectScope and CorbaObjectExclude to it.
+ *   .
+ *
+ *   name: CorbaResolveThreads
+ *   - value:        number from 1 to 64
+ *   - default:      4
+ *   - context:      global config, virtual host
+ *   - description:
+ *         Maximal number of threads which resolve objects in nameservice
+ *         in parallel when IOR cache is filled. Value 1 resolves objects
+ *         one after another. Each object is resolved by one connection at a
+ *         time, other connections of the child which miss the same object
+ *         wait for the result instead of resolving it again.
+ *   .
+ *
+ *   name: CorbaEarlyAcquire
+ *   - value:        On, Off
+ *   - default:      Off
+ *   - context:      global config, virtual host
+ *   - description:
+ *         Object references are acquired in a separate thread started in
+ *         pre_connection hook, so that resolution of objects on cache miss
+ *         runs in parallel with TLS handshake. Modules using the references
+ *         must obtain them by optional function corba_connection_objects()
+ *         declared in mod_corba.h, which waits for the acquisition. Has no
+ *         effect if apache is built without threads.
+ *   .
+ *
+ *   name: CorbaProbeInterval
+ *   - value:        number of seconds
+ *   - default:      0 (disabled)
+ *   - context:      global config
+ *   - description:
+ *         Interval of background liveness probes. Each child periodically
+ *         calls _non_existent on every cached object from a separate thread.
+ *         IOR strings of objects which fail are evicted from the cache and
+ *         resolved again on next access. Health of objects is available to
+ *         other modules through optional function corba_object_alive()
+ *         declared in mod_corba.h.
+ *   .
+ *
+ *   name: CorbaProbeTimeout
+ *   - value:        number of milliseconds
+ *   - default:      1000
+ *   - context:      global config
+ *   - description:
+ *         Liveness probe which takes longer is considered failed. ORBit2 does
+ *         not allow to interrupt the call, so a hung backend delays only the
+ *         prober thread. The object is reported dead and evicted from the
+ *         cache as soon as its probe exceeds the timeout; other objects are
+ *         not probed until the hung probe returns, their health stays as
+ *         seen by their last probe.
+ *   .
+ *
+ *   name: CorbaMaxConcurrent
+ *   - value:        alias limit [queue]
+ *   - default:      none
+ *   - context:      global config
+ *   - description:
+ *         Limits number of concurrent calls of object given by alias in all
+ *         children to limit. When the limit is reached, at most queue calls
+ *         (default 0) wait for admission (see CorbaQueueTimeout), further
+ *         calls are rejected immediately. The limit is enforced for modules
+ *         which wrap their calls of the object in optional functions
+ *         corba_call_begin() and corba_call_end() declared in mod_corba.h.
+ *         Admissions of a child which dies without cleanup are reclaimed
+ *         by the parent. The queue is approximate, waiting calls are not
+ *         admitted in order of their arrival.
+ *   .
+ *
+ *   name: CorbaMaxBackendSockets
+ *   - value:        alias sockets
+ *   - default:      none
+ *   - context:      global config
+ *   - description:
+ *         Limits number of GIOP connections to object given by alias from
+ *         all children. ORBit uses one connection per object (endpoint) in
+ *         each child, so the limit says how many children may be connected
+ *         to the object at once. A call which would open connection above
+ *         the limit is rejected by corba_call_begin() (see
+ *         CorbaMaxConcurrent). Use with CorbaGIOPIdleTimeout, so that
+ *         children which do not call the object release their connection.
+ *         Connections of a child which dies without cleanup are returned
+ *         to the limit by the parent.
+ *   .
+ *
+ *   name: CorbaGIOPIdleTimeout
+ *   - value:        number of seconds
+ *   - default:      0 (connections are not closed)
+ *   - context:      global config
+ *   - description:
+ *         GIOP connection of object which was not called for given time is
+ *         closed by background thread of each child. References of the
+ *         object stay valid, the connection is opened again by next call.
+ *         Connection shared by objects of the same server is closed only
+ *         when all of them are idle, none of them is being called and no
+ *         call of nameservice or liveness probe uses the connection. Calls
+ *         are known to mod_corba only from modules which use
+ *         corba_call_begin() and corba_call_end().
+ *   .
+ *
+ *   name: CorbaQueueTimeout
+ *   - value:        number of milliseconds
+ *   - default:      100
+ *   - context:      global config
+ *   - description:
+ *         Longest time a call waits for admission by CorbaMaxConcurrent
+ *         before it is rejected.
+ *   .
+ *
+ *   name: CorbaIORFile
+ *   - value:        path to file or directory
+ *   - default:      none
+ *   - context:      global config
+ *   - description:
+ *         File (or all files of directory) with lines "alias IOR" or
+ *         "alias CONTEXTNAME.OBJECTNAME", lines starting by '#' are ignored.
+ *         Objects of the file are put in IOR cache of each child and take
+ *         precedence over objects from nameservice. The file is watched by
+ *         inotify, so its changes are applied to IOR cache immediately
+ *         without restart of apache; deployment tools should replace the
+ *         file by rename. Objects removed from the file are resolved in
+ *         nameservice again, a deleted file maps no objects. Without inotify
+ *         the file is read only at start of child.
+ *   .
+ *
+ *   name: CorbaObjectScope
+ *   - value:        alias [alias ...]
+ *   - default:      none (all objects are managed)
+ *   - context:      global config, virtual host
+ *   - description:
+ *         Restricts objects managed for the server to the given aliases.
+ *         Other configured or inherited objects are neither resolved nor
+ *         exported for the server's connections.
+ *   .
+ *
+ *   name: CorbaObjectExclude
+ *   - value:        alias [alias ...]
+ *   - default:      none
+ *   - context:      global config, virtual host
+ *   - description:
+ *         Objects with the given aliases are neither resolved nor exported
+ *         for the server's connections.
+ *   .
+ *
+ *   name: CorbaAdminAllow
+ *   - value:        address[/mask] [address[/mask] ...]
+ *   - default:      127.0.0.0/8 ::1
+ *   - context:      global config, virtual host
+ *   - description:
+ *         IP addresses or networks of clients allowed to use corba-admin
+ *         handler, other clients are refused by the handler itself. Mask
+ *         is given either in bits or as dotted address.
+ *   .
+ *
+ * CorbaNameservice, CorbaObject, CorbaObjectContext, CorbaResolveThreads and
+ * CorbaAdminAllow configuration values are in virtual servers inherited from
+ * main server, which can be exploited to set these settings just once for
+ * all servers. CorbaEnable must be enabled explicitly for each virtual
+ * server - this directive is not inherited. Neither CorbaObjectScope nor
+ * CorbaObjectExclude are inherited, they restrict the set of objects of the
+ * server where they are used.
+ *
+ * @section admin Runtime flush of IOR cache
+ *
+ * After redeploy of backend servers cached IOR strings may be flushed without
+ * restart of apache by handler "corba-admin". GET request prints state of
+ * IOR cache, POST request with query string "flush" flushes IOR cache of all
+ * children, "flush=alias1,alias2" flushes only given aliases (or contexts of
+ * CorbaObjectContext). Each child rebuilds its cache on next access. The
+ * handler refuses clients not allowed by CorbaAdminAllow (only localhost by
+ * default), access may be further restricted in its location, for example:
+ *
+ * @verbatim
+<Location /corba-admin>
+    SetHandler corba-admin
+    Require ip 127.0.0.1
+</Location>
+@endverbatim
+ *
+ * and cache is flushed by: curl -X POST 'http://localhost/corba-admin?flush'
+ *
+ * GET request prints also counters shared by all children: number of
+ * connections, cache fills, resolves at nameservice and their failures,
+ * number of object references currently held by connections and percentiles
+ * and maximum of time spent by obtaining references for a connection and of
+ * time spent by waiting for cache lock. The counters serve for stress testing
+ * of the module; number of held references must drop to zero when all
+ * connections are closed. POST request with query string "reset" zeroes the
+ * counters. Test stress_connections (built with cmake option ENABLE_TESTS,
+ * run by ctest) checks them while many threads open connections and a fake
+ * nameservice goes down, comes back, answers slowly and returns changed
+ * IORs.
+ *
+ * Calls of remote objects are counted per object alias and operation
+ * (number of calls, raised exceptions, percentiles and maximum of duration).
+ * Calls of nameservice and liveness probes are recorded by mod_corba itself,
+ * calls of other modules are recorded when they report them through optional
+ * function corba_call_record() declared in mod_corba.h. For objects limited
+ * by CorbaMaxConcurrent or CorbaMaxBackendSockets the number of active and
+ * waiting calls, the number of rejected calls and the number of open GIOP
+ * connections of all children are printed. Number of open GIOP connections
+ * of the child which served the request (connection shared by objects of
+ * the same server is counted once) is printed as well.
  *
  * mod_corba alone is not meaningfull. It is intended to be used by other
  * modules. For reasonable example of mod_corba's configuration in conjunction
@@ -32,6 +32,8 @@
 #include "http_log.h"
 #include "http_config.h"
 #include "http_connection.h"	/* connection hooks */
+#include "http_protocol.h"
+#include "http_request.h"
 
 #include "apr_pools.h"
 #include "apr_strings.h"
@@ -45,8 +47,31 @@
 #include "config.h"
 #endif
 
+#include "mod_corba.h"
+
+#include "apr_atomic.h"
+#include "apr_shm.h"
+#include "apr_file_io.h"
+#include "apr_file_info.h"
+
 #if APR_HAS_THREADS
 #include "apr_thread_mutex.h"
+#include "apr_thread_cond.h"
+#include "apr_thread_proc.h"
+#endif
+
+#include "ap_mpm.h"		/* monitor hook */
+#if !AP_MODULE_MAGIC_AT_LEAST(20111130, 0)
+#include "mpm_common.h"
+#endif
+
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+
+#if APR_HAS_THREADS && defined(HAVE_SYS_INOTIFY_H)
+#include <sys/inotify.h>
+#include <poll.h>
 #endif
 
 #ifdef APR_NEED_SET_MUTEX_PERMS
@@ -58,6 +83,25 @@
  */
 module AP_MODULE_DECLARE_DATA corba_module;
 
+/** Number of objects whose concurrent calls may be limited. */
+#define LIMIT_SLOTS             32
+
+/** Number of children whose admissions of limited calls are tracked. */
+#define CHILD_SLOTS             256
+
+/** Interval of polling for admission of waiting call. */
+#define LIMIT_POLL              apr_time_from_msec(1)
+
+/**
+ * Configured limit of concurrent calls of one object.
+ */
+typedef struct {
+	const char  *alias;              /**< Alias of object. */
+	int          limit;              /**< Maximal number of concurrent calls. */
+	int          queue;              /**< Maximal number of waiting calls. */
+	int          sockets;            /**< Maximal number of GIOP connections. */
+} limit_conf_t;
+
 /**
  * Configuration structure of corba module.
  */
@@ -66,689 +110,4021 @@ typedef struct {
 	int          ior_cache_enabled;  /**< Whether IOR caching is enabled. */
     const char  *ns_loc;             /**< Location of CORBA nameservice. */
 	apr_table_t *objects;            /**< Names and aliases of managed objects. */
-    CORBA_ORB    orb;                /**< Variables needed for corba submodule. */
+	apr_table_t *scope;              /**< Aliases restricted to (NULL = all). */
+	apr_table_t *exclude;            /**< Aliases excluded from inherited objects. */
+	int          resolve_threads;    /**< Threads resolving objects on cache fill. */
+	apr_array_header_t *contexts;    /**< Contexts whose all objects are managed. */
+	int          probe_interval;     /**< Seconds between liveness probes (0 = off). */
+	int          probe_timeout;      /**< Probe slower than this (msec) fails. */
+	int          early_acquire;      /**< Acquire references in pre_connection hook. */
+	apr_array_header_t *limits;      /**< Limits of concurrent calls (limit_conf_t). */
+	int          queue_timeout;      /**< Longest wait for admission of call (msec). */
+	const char  *ior_file;           /**< File (directory) with IORs of objects. */
+	int          idle_timeout;       /**< Seconds after which idle GIOP connection is closed (0 = never). */
+	apr_array_header_t *admin_allow; /**< Clients allowed to use corba-admin (NULL = localhost). */
 } corba_conf;
 
+/** Number of per-alias flush generations kept in shared memory. */
+#define FLUSH_SLOTS             64
+
+/** Number of buckets of latency histograms (powers of 2 microseconds). */
+#define STATS_BUCKETS           24
+
 /**
- * Per-child cache structure
+ * Counters of module activity summed over all children.
+ */
+typedef struct {
+    volatile apr_uint32_t connections;      /**< Connections served. */
+    volatile apr_uint32_t fills;            /**< IOR cache fills. */
+    volatile apr_uint32_t resolves;         /**< Objects resolved in nameservice. */
+    volatile apr_uint32_t resolve_errors;   /**< Failed resolves. */
+    volatile apr_uint32_t references;       /**< References currently held by connections. */
+    volatile apr_uint32_t acquire_max;      /**< Longest acquisition of references (us). */
+    volatile apr_uint32_t lock_wait_max;    /**< Longest wait for cache mutex (us). */
+    volatile apr_uint32_t acquire_hist[STATS_BUCKETS];   /**< Acquisition of references per connection. */
+    volatile apr_uint32_t lock_wait_hist[STATS_BUCKETS]; /**< Waits for cache mutex. */
+} corba_stats_t;
+
+/** Number of alias - operation pairs whose calls are recorded. */
+#define CALL_SLOTS              128
+
+/** Maximal recorded length of alias and operation name. */
+#define CALL_NAME_LEN           48
+
+/**
+ * Counters of calls of one operation of one object summed over all children.
+ */
+typedef struct {
+    volatile apr_uint32_t state;            /**< 0 free, 1 being claimed, 2 used. */
+    char                  alias[CALL_NAME_LEN];     /**< Alias of object. */
+    char                  operation[CALL_NAME_LEN]; /**< Name of operation. */
+    volatile apr_uint32_t calls;            /**< Number of calls. */
+    volatile apr_uint32_t exceptions;       /**< Calls which raised exception. */
+    volatile apr_uint32_t max;              /**< Longest call (us). */
+    volatile apr_uint32_t hist[STATS_BUCKETS]; /**< Durations of calls. */
+} call_stats_t;
+
+/**
+ * Admission control of calls of one object shared by all children.
+ */
+typedef struct {
+    char                  alias[CALL_NAME_LEN]; /**< Alias of object. */
+    apr_uint32_t          limit;            /**< Maximal number of concurrent calls. */
+    apr_uint32_t          queue;            /**< Maximal number of waiting calls. */
+    apr_uint32_t          wait;             /**< Longest wait for admission (msec). */
+    volatile apr_uint32_t active;           /**< Calls in progress. */
+    volatile apr_uint32_t waiting;          /**< Calls waiting for admission. */
+    volatile apr_uint32_t rejected;         /**< Rejected calls. */
+    apr_uint32_t          sockets_max;      /**< Maximal number of GIOP connections (0 = unlimited). */
+    volatile apr_uint32_t sockets;          /**< Open GIOP connections of all children. */
+} limit_t;
+
+/**
+ * Admissions of limited calls and GIOP connections of one child, so that
+ * parent can return admissions of a child which died without cleanup to
+ * the limits.
+ */
+typedef struct {
+    volatile apr_uint32_t pid;              /**< Pid of child, 0 if slot is free. */
+    volatile apr_uint32_t held[LIMIT_SLOTS];    /**< Admitted calls not finished. */
+    volatile apr_uint32_t waiting[LIMIT_SLOTS]; /**< Calls waiting for admission. */
+    volatile apr_uint32_t sockets[LIMIT_SLOTS]; /**< Open GIOP connections. */
+} admissions_t;
+
+/**
+ * Structure shared by all children, created in post config hook.
+ */
+typedef struct {
+    volatile apr_uint32_t generation;       /**< Generation of whole cache. */
+    volatile apr_uint32_t flushes;          /**< Number of per-alias flushes. */
+    volatile apr_uint32_t alias_generation[FLUSH_SLOTS]; /**< Generations of aliases (slot by hash). */
+    corba_stats_t         stats;            /**< Counters of module activity. */
+    call_stats_t          calls[CALL_SLOTS]; /**< Counters of calls (slot by hash). */
+    limit_t               limits[LIMIT_SLOTS]; /**< Limits of concurrent calls. */
+    admissions_t          children[CHILD_SLOTS]; /**< Admissions of children. */
+} corba_shared_t;
+
+static corba_shared_t *shared;
+
+/** Limits of concurrent calls alias - limit_t (set in post config hook). */
+static apr_hash_t *limits;
+
+/** Admissions of this child if no slot of shared memory was free. */
+static admissions_t local_admissions;
+
+/** Admissions of this child (slot claimed in child init). */
+static admissions_t *admissions = &local_admissions;
+
+/** Increment of counter of module activity. */
+#define STATS_INC(counter) \
+	do { if (shared != NULL) apr_atomic_inc32(&shared->stats.counter); } while (0)
+
+/** Decrement of counter of module activity. */
+#define STATS_DEC(counter) \
+	do { if (shared != NULL) apr_atomic_dec32(&shared->stats.counter); } while (0)
+
+/**
+ * Health of object as seen by the last liveness probe.
+ */
+typedef struct {
+    int                 alive;      /**< 1 if object is alive, 0 if dead. */
+    apr_time_t          checked;    /**< Time of last probe. */
+    apr_interval_time_t latency;    /**< Duration of last probe. */
+} health_t;
+
+/**
+ * One generation of IOR cache. Generation is never modified once it is
+ * published, every change of cache builds a new generation in a fresh pool
+ * and swaps it in. The previous generation is destroyed (and its memory
+ * returned) as soon as no connection references it.
  */
 typedef struct {
-    apr_pool_t *pool;               /**< Pool used for allocation of IOR table. */
+    apr_pool_t *pool;               /**< Own (unmanaged) pool of generation. */
     apr_table_t *iors;              /**< IOR cache alias - ior. */
+    apr_hash_t *contexts;           /**< Discovered objects context - table alias - name. */
+    volatile apr_uint32_t refs;     /**< References (cache itself holds one). */
+} ior_gen_t;
+
+/**
+ * Object referenced by connections of child and its GIOP connection.
+ */
+typedef struct {
+    const char     *alias;          /**< Alias of object. */
+    apr_uint32_t    refs;           /**< References held by connections. */
+    int             connected;      /**< Object was called since connection was closed. */
+    apr_uint32_t    inflight;       /**< Calls between corba_call_begin() and corba_call_end(). */
+    ORBitConnection *cnx;           /**< Reference of GIOP connection of object (NULL = not known yet). */
+    apr_time_t      last_used;      /**< Time of last call. */
+    limit_t        *lim;            /**< Shared limits of object or NULL. */
+} backend_t;
+
+/**
+ * Per-child cache structure
+ */
+typedef struct {
+    ior_gen_t *current;             /**< Current generation of IOR cache. */
+    apr_uint32_t generation;        /**< Last seen shared generation. */
+    apr_uint32_t flushes;           /**< Last seen number of per-alias flushes. */
+    apr_uint32_t alias_generation[FLUSH_SLOTS]; /**< Last seen generations of aliases. */
+    apr_pool_t *health_pool;        /**< Pool used for allocation of health table. */
+    apr_hash_t *health;             /**< Health of probed objects alias - health_t. */
+    const char *probe_alias;        /**< Alias being probed (NULL = none). */
+    const char *probe_ior;          /**< IOR string being probed. */
+    apr_time_t  probe_started;      /**< Start of probe in progress. */
+    int         probe_failed;       /**< Probe in progress exceeded timeout. */
+    apr_interval_time_t probe_timeout; /**< Probe slower than this fails. */
+    apr_hash_t *inflight;           /**< Objects being resolved by some connection. */
+    apr_hash_t *inflight_contexts;  /**< Contexts being listed by some connection. */
+    apr_uint32_t fills_dropped;     /**< Fills whose results were dropped by flush. */
+    apr_pool_t *file_pool;          /**< Pool of objects of IOR file. */
+    apr_table_t *file_iors;         /**< Objects of IOR file alias - ior (NULL = none). */
+    apr_pool_t *backend_pool;       /**< Pool used for allocation of backends. */
+    apr_hash_t *backends;           /**< Referenced objects alias - backend_t. */
+    int         sockets;            /**< Open GIOP connections to objects (per endpoint). */
+    apr_array_header_t *other_calls; /**< GIOP connections of nameservice calls and probes in flight. */
 #if APR_HAS_THREADS
     apr_thread_mutex_t *mutex;      /**< Mutex if needed by threaded server. */
+    apr_thread_cond_t *filled;      /**< Signalled when a fill of cache ends. */
 #endif
 } cache_t;
 
 static cache_t *cache;
 
+/** Per-child ORB, created in child init and destroyed on child exit. */
+static CORBA_ORB orb;
 
-#if AP_SERVER_MINORVERSION_NUMBER == 0
-/**
- * ap_log_cerror is defined only if apache version is 2.0 because 2.0
- * contrary to 2.2 does not have this function.
- */
-#define ap_log_cerror(mark, level, status, c, ...) \
-	ap_log_error(mark, level, status, (c)->base_server, __VA_ARGS__)
-#endif
-
-/** Quick test if corba exception was raised. */
-#define raised_exception(ev)    ((ev)->_major != CORBA_NO_EXCEPTION)
+static int corba_object_in_scope(const corba_conf *sc, const char *alias);
 
 /**
- * This structure is passed to reference cleanup routine.
+ * Function records duration in histogram and maximum of latencies.
  *
- * We pass also the connection id in order to track references when
- * debug log is enabled.
+ * @param hist     Histogram with STATS_BUCKETS buckets.
+ * @param max      Maximal duration.
+ * @param elapsed  Recorded duration.
  */
-struct reference_cleanup_arg {
-	void            *service;
-	const conn_rec  *c;
-	const char      *alias;
-};
+static void stats_latency(volatile apr_uint32_t *hist,
+        volatile apr_uint32_t *max, apr_interval_time_t elapsed)
+{
+    apr_uint32_t    usec = (elapsed > 0xffffffff) ? 0xffffffff : elapsed;
+    apr_uint32_t    old;
+    apr_uint32_t    v;
+    unsigned        bucket = 0;
+
+    if (shared == NULL)
+        return;
+    for (v = usec; v > 1 && bucket < STATS_BUCKETS - 1; v >>= 1)
+        bucket++;
+    apr_atomic_inc32(&hist[bucket]);
+    while ((old = apr_atomic_read32(max)) < usec &&
+           apr_atomic_cas32(max, usec, old) != old)
+        ;
+}
 
 /**
- * Cleanup routine releases corba object reference.
- *
- * This routine is called upon destroying connection pool.
+ * Function finds (or claims) slot of call counters for alias and operation.
+ * Slot being claimed by another process is skipped, at worst the pair gets
+ * two slots.
  *
- * @param object  The object reference.
+ * @param alias      Alias of object.
+ * @param operation  Name of operation.
+ * @return           Slot, NULL if all slots are used.
  */
-static apr_status_t reference_cleanup(void *raw_arg)
+static call_stats_t *call_stats_slot(const char *alias, const char *operation)
 {
-	CORBA_Environment ev[1];
-	struct reference_cleanup_arg *arg = raw_arg;
+    call_stats_t   *slot;
+    const char     *p;
+    unsigned        hash = 5381;
+    unsigned        i, n;
 
-	CORBA_exception_init(ev);
-
-	/* releasing managed object */
-	CORBA_Object_release(arg->service, ev);
-	if (raised_exception(ev)) {
-		ap_log_cerror(APLOG_MARK, APLOG_ERR, 0, arg->c,
-			"mod_corba: error when releasing corba object: %s.",
-			ev->_id);
-		return APR_EGENERAL;
-	}
-	CORBA_exception_free(ev);
+    for (p = alias; *p != '\0'; p++)
+        hash = hash * 33 + (unsigned char) *p;
+    for (p = operation; *p != '\0'; p++)
+        hash = hash * 33 + (unsigned char) *p;
 
-	ap_log_cerror(APLOG_MARK, APLOG_DEBUG, 0, arg->c,
-		"mod_corba: reference with alias '%s', belonging to "
-		"connection %ld was released.", arg->alias, arg->c->id);
-	return APR_SUCCESS;
+    for (n = 0, i = hash % CALL_SLOTS; n < CALL_SLOTS;
+            n++, i = (i + 1) % CALL_SLOTS) {
+        slot = &shared->calls[i];
+        switch (apr_atomic_cas32(&slot->state, 1, 0)) {
+        case 0:
+            apr_cpystrn(slot->alias, alias, CALL_NAME_LEN);
+            apr_cpystrn(slot->operation, operation, CALL_NAME_LEN);
+            apr_atomic_set32(&slot->state, 2);
+            return slot;
+        case 2:
+            if (strncmp(slot->alias, alias, CALL_NAME_LEN - 1) == 0 &&
+                strncmp(slot->operation, operation, CALL_NAME_LEN - 1) == 0)
+                return slot;
+            break;
+        default:
+            break;
+        }
+    }
+    return NULL;
 }
 
-/** 
- * Context structure passed between get_reference_from_() and connection
- * handler. 
- */
-struct get_reference_ctx {
-	conn_rec	               *c;             /**< Current connection. */
-    CORBA_ORB                   orb;           /**< Orb. */
-	apr_hash_t	               *objects;       /**< Hash table of object references. */
-    CosNaming_NamingContext     nameservice;   /**< Corba nameservice. */
-};
-
-/** 
- * Context structure passed between get_ior_from_nameservice() and post config
- * hook. 
+/**
+ * Function records one call of remote object. The function is exported
+ * for modules which use the references, so that their calls are counted
+ * with calls of mod_corba itself.
+ *
+ * @param alias      Alias of object.
+ * @param operation  Name of operation.
+ * @param elapsed    Duration of call.
+ * @param exception  Nonzero if the call raised exception.
  */
-//struct get_ior_ctx {
-//    server_rec                 *s;               /**< Current server. */
-//    CORBA_ORB                   orb;             /**< Orb. */
-//    apr_table_t                *ior_cache;       /**< Table for storing pair alias-IOR.*/
-//    CosNaming_NamingContext     nameservice;     /**< Corba nameservice. */
-//};
+static void corba_call_record(const char *alias, const char *operation,
+        apr_interval_time_t elapsed, int exception)
+{
+    call_stats_t *slot;
 
+    if (shared == NULL || alias == NULL || operation == NULL)
+        return;
+    if ((slot = call_stats_slot(alias, operation)) == NULL)
+        return;
+    apr_atomic_inc32(&slot->calls);
+    if (exception)
+        apr_atomic_inc32(&slot->exceptions);
+    stats_latency(slot->hist, &slot->max, elapsed);
+}
 
 /**
- * Function returns reference from nameservice (defined at context structure)
- * for object given by name
+ * Function admits call of limited object if its limit is not reached.
  *
- * @param pctx    Context pointer.
- * @param alias   Alias of object.
- * @param name    Name of object.
- * @return        service if successfull, NULL in case of failure.
+ * @param lim   Limit of object.
+ * @return      1 if the call was admitted, 0 otherwise.
  */
-static void* get_reference_for_service(void *pctx, const char *alias, const char *name) 
+static int limit_try_enter(limit_t *lim)
 {
-    void    *service;
-    const char  *p;
-    CORBA_Environment   ev[1];
-    CosNaming_Name  cos_name;
-    CosNaming_NameComponent name_component[2] = { {NULL, "context"},
-        {NULL, "Object"} };
-    
-    struct get_reference_ctx *ctx = pctx;
-    ap_log_cerror(APLOG_MARK, APLOG_DEBUG, 0, ctx->c,
-            "call get_reference_for_service(%s, %s)", alias, name);
+    apr_uint32_t active;
 
-    /* divide name in two parts - context and object's name */
-    for (p = name; *p != '\0'; p++) {
-        if (*p == '.') break;
-    }
-    if (*p == '\0') {
-        name_component[0].id = apr_pstrdup(ctx->c->pool, CONTEXT_NAME);
-        name_component[1].id = (char *) name;
-    }
-    else {
-        name_component[0].id = apr_pstrmemdup(ctx->c->pool, name,
-                p - name);
-        name_component[1].id = apr_pstrdup(ctx->c->pool, p + 1);
-    }
-    cos_name._maximum = cos_name._length = 2;
-    cos_name._buffer = name_component;
-    
-    /* get object's reference */ 
-    CORBA_exception_init(ev);
-    service = CosNaming_NamingContext_resolve(ctx->nameservice, &cos_name, ev);
-    if (service == CORBA_OBJECT_NIL || raised_exception(ev)) {
-        ap_log_cerror(APLOG_MARK, APLOG_ERR, 0, ctx->c,
-            "mod_corba: Could not obtain reference of "
-            "object '%s': %s.", name,
-            (ev->_id) ? ev->_id : "Unknown error");
-        CORBA_exception_free(ev);
-        return NULL;
+    if (lim->limit == 0)
+        return 1;
+    while ((active = apr_atomic_read32(&lim->active)) < lim->limit) {
+        if (apr_atomic_cas32(&lim->active, active + 1, active) == active) {
+            apr_atomic_inc32(&admissions->held[lim - shared->limits]);
+            return 1;
+        }
     }
-    
-    return service;
+    return 0;
 }
 
 /**
- * Function obtains one reference from corba nameservice and sticks the
- * reference to connection.
+ * Function asks for admission of call of object limited by
+ * CorbaMaxConcurrent. If the limit is reached, the call waits (at most
+ * CorbaQueueTimeout) unless the queue of waiting calls is full, in which
+ * case it is rejected at once.
+ *
+ * The queue is only approximate: waiting calls poll the limit, so they are
+ * not admitted in order of arrival and a new call may overtake them, and
+ * calls of a child which died are counted until the parent reclaims them.
  *
- * @param pctx    Context pointer.
  * @param alias   Alias of object.
- * @param name    Name of object.
- * @return        1 if successfull, 0 in case of failure.
+ * @return        1 if the call was admitted, 0 if it was rejected.
  */
-static int get_reference_from_nameservice(void *pctx, const char *alias, const char *name)
+static int limit_enter(const char *alias)
 {
-    struct get_reference_ctx *ctx = pctx;
-     ap_log_cerror(APLOG_MARK, APLOG_DEBUG, 0, ctx->c,
-            "call get_reference_from_nameservice(%s, %s)", alias, name);
-   
-    void *service = (void *) get_reference_for_service(pctx, alias, name);
-    if (service == NULL) {
-        return 0;
-    }
-    
-    struct reference_cleanup_arg    *cleanup_arg;
-
-    /* register cleanup routine for reference */
-    cleanup_arg = apr_palloc(ctx->c->pool, sizeof *cleanup_arg);
-    cleanup_arg->c       = ctx->c;
-    cleanup_arg->alias   = alias;
-    cleanup_arg->service = service;
-    apr_pool_cleanup_register(ctx->c->pool, cleanup_arg, reference_cleanup,
-            apr_pool_cleanup_null);
+    limit_t     *lim;
+    apr_time_t   deadline;
+    int          admitted = 0;
+    volatile apr_uint32_t *waiting;
 
-    /* save object in connection notes */
-    apr_hash_set(ctx->objects, alias, strlen(alias), service);
-    
-    ap_log_cerror(APLOG_MARK, APLOG_DEBUG, 0, ctx->c,
-        "mod_corba: reference '%s' with alias '%s', belonging to "
-        "connection %ld was obtained from corba nameservice.", name, alias, ctx->c->id);
+    if (shared == NULL || limits == NULL ||
+        (lim = apr_hash_get(limits, alias, APR_HASH_KEY_STRING)) == NULL)
+        return 1;
+    if (limit_try_enter(lim))
+        return 1;
 
-    return 1;
+    /* join bounded queue of waiting calls or fail fast */
+    if (apr_atomic_inc32(&lim->waiting) >= lim->queue) {
+        apr_atomic_dec32(&lim->waiting);
+        apr_atomic_inc32(&lim->rejected);
+        return 0;
+    }
+    waiting = &admissions->waiting[lim - shared->limits];
+    apr_atomic_inc32(waiting);
+    deadline = apr_time_now() + apr_time_from_msec(lim->wait);
+    do {
+        apr_sleep(LIMIT_POLL);
+        admitted = limit_try_enter(lim);
+    } while (!admitted && apr_time_now() < deadline);
+    apr_atomic_dec32(waiting);
+    apr_atomic_dec32(&lim->waiting);
+    if (!admitted)
+        apr_atomic_inc32(&lim->rejected);
+    return admitted;
 }
 
-
 /**
- * Function obtains IOR string for one object registered in mod_corba and
- * assign it to IOR cache table.
+ * Function finishes call admitted by limit_enter().
  *
- * @param pctx    Context pointer.
  * @param alias   Alias of object.
- * @param name    Name of object.
- * @return        1 if successfull, 0 in case of failure.
  */
-static int get_ior_from_nameservice(void *pctx, const char *alias, const char *name)
+static void limit_leave(const char *alias)
 {
-    char               *ior;
-    CORBA_Environment   ev[1];
-    
-    struct get_reference_ctx *ctx = pctx;      	
-    ap_log_cerror(APLOG_MARK, APLOG_DEBUG, 0, ctx->c,
-            "call get_ior_from_nameservice(%s, %s)", alias, name);
-
-	void *service = (void *) get_reference_for_service(pctx, alias, name);
-    if (service == NULL) {
-        return 0;
-    }
-    
-    CORBA_exception_init(ev);
-    
-    /* translate it to IOR string */
-    ior = CORBA_ORB_object_to_string(ctx->orb, service, ev);
-    if (raised_exception(ev)) {
-		ap_log_cerror(APLOG_MARK, APLOG_ERR, 0, ctx->c,
-			"mod_corba: Could not obtain IOR string from "
-			"object '%s': %s.", name,
-			(ev->_id) ? ev->_id : "Unknown error");
+    limit_t                 *lim;
+    volatile apr_uint32_t   *held;
+    apr_uint32_t             n;
 
-		CORBA_Object_release(service, ev);
-        CORBA_exception_free(ev);
-		return 0;
-    }
-    CORBA_Object_release(service, ev);
+    if (shared == NULL || limits == NULL ||
+        (lim = apr_hash_get(limits, alias, APR_HASH_KEY_STRING)) == NULL)
+        return;
 
-    apr_table_set(cache->iors, alias, ior);
-    
-    ap_log_cerror(APLOG_MARK, APLOG_DEBUG, 0, ctx->c,
-            "mod_corba: Stored object '%s' IOR string: '%s'", 
-            name, ior);
+    /* never release more calls than this child was admitted */
+    held = &admissions->held[lim - shared->limits];
+    do {
+        if ((n = apr_atomic_read32(held)) == 0)
+            return;
+    } while (apr_atomic_cas32(held, n - 1, n) != n);
+    apr_atomic_dec32(&lim->active);
+}
 
-	return 1;
+/**
+ * Function counts GIOP connection of child to object limited by
+ * CorbaMaxBackendSockets.
+ *
+ * @param lim   Limit of object.
+ * @return      1 if the connection may be opened, 0 otherwise.
+ */
+static int limit_socket_open(limit_t *lim)
+{
+    apr_uint32_t n;
 
+    do {
+        n = apr_atomic_read32(&lim->sockets);
+        if (lim->sockets_max > 0 && n >= lim->sockets_max) {
+            apr_atomic_inc32(&lim->rejected);
+            return 0;
+        }
+    } while (apr_atomic_cas32(&lim->sockets, n + 1, n) != n);
+    apr_atomic_inc32(&admissions->sockets[lim - shared->limits]);
+    return 1;
 }
 
 /**
- * Caching support functions
+ * Function releases GIOP connection counted by limit_socket_open().
+ *
+ * @param lim   Limit of object.
  */
+static void limit_socket_close(limit_t *lim)
+{
+    volatile apr_uint32_t   *held = &admissions->sockets[lim - shared->limits];
+    apr_uint32_t             n;
+
+    /* never release more connections than this child counted */
+    do {
+        if ((n = apr_atomic_read32(held)) == 0)
+            return;
+    } while (apr_atomic_cas32(held, n - 1, n) != n);
+    apr_atomic_dec32(&lim->sockets);
+}
 
 /**
- * Function should delete whole cache and allocate new one.
- * This is not used because if we refilling cache we just replace IOR string
- * for new one for same object alias. Deletion is delegated to apr_table_set
- * function.
+ * Function returns admissions and GIOP connections of child to the
+ * limits. Counters of child are zeroed.
  *
-static int ior_cache_garbage() {
-    if (cache) {
-#if APR_HAS_THREADS
-        apr_thread_mutex_lock(cache->mutex);
-#endif
-        apr_pool_clear(cache->pool);
-        cache->iors = apr_table_make(cache->pool, 5);
-#if APR_HAS_THREADS
-        apr_thread_mutex_unlock(cache->mutex);
-#endif
-        return 1;
+ * @param adm   Admissions of child.
+ */
+static void limits_release(admissions_t *adm)
+{
+    apr_uint32_t n;
+    int          i;
+
+    for (i = 0; i < LIMIT_SLOTS; i++) {
+        if ((n = apr_atomic_xchg32(&adm->held[i], 0)) > 0)
+            apr_atomic_sub32(&shared->limits[i].active, n);
+        if ((n = apr_atomic_xchg32(&adm->waiting[i], 0)) > 0)
+            apr_atomic_sub32(&shared->limits[i].waiting, n);
+        if ((n = apr_atomic_xchg32(&adm->sockets[i], 0)) > 0)
+            apr_atomic_sub32(&shared->limits[i].sockets, n);
     }
-    return 0;
 }
- */
 
 /**
- * Function fills IOR cache with IOR strings configured for given server 
+ * Function claims slot of shared memory for admissions of this child, so
+ * that they can be reclaimed by parent if the child dies.
  *
- * @param s    Server structure pointer.
- * @return     1 if successfull, 0 in case of failure.
+ * @param s   Main server (used for logging).
  */
-static int ior_cache_fill(void *pctx) {
-	CORBA_Environment	    ev[1];
-    CosNaming_NamingContext nameservice;
-    char	                ns_string[150];
-    
-    struct get_reference_ctx *ctx = pctx;
-   
-    server_rec  *s  = ctx->c->base_server;
-    corba_conf  *sc = (corba_conf *)
-		ap_get_module_config(s->module_config, &corba_module);
+static void limits_child_init(server_rec *s)
+{
+    apr_uint32_t pid = (apr_uint32_t) getpid();
+    int          i;
 
-    ap_log_cerror(APLOG_MARK, APLOG_DEBUG, 0, ctx->c,
-        "call ior_cache_fill()");
+    if (shared == NULL || limits == NULL || apr_hash_count(limits) == 0)
+        return;
+    for (i = 0; i < CHILD_SLOTS; i++) {
+        if (apr_atomic_cas32(&shared->children[i].pid, pid, 0) == 0) {
+            admissions = &shared->children[i];
+            return;
+        }
+    }
+    ap_log_error(APLOG_MARK, APLOG_WARNING, 0, s,
+        "mod_corba: no free slot for admissions of child, they will not "
+        "be reclaimed if the child dies.");
+}
 
-    /* do initialization of corba */
-	CORBA_exception_init(ev);
+/**
+ * Cleanup releasing calls admitted to this child which were not finished,
+ * so that exit of child does not decrease limits of other children.
+ *
+ * @param data   Not used.
+ * @return       Always success.
+ */
+static apr_status_t limits_cleanup(__attribute__((unused)) void *data)
+{
+    admissions_t *adm = admissions;
 
-    /* get nameservice's reference */
-    ns_string[149] = 0;
-    snprintf(ns_string, 149, "corbaloc::%s/NameService", sc->ns_loc);
-    
-    nameservice = (CosNaming_NamingContext)
-        CORBA_ORB_string_to_object(ctx->orb, ns_string, ev);
-    if (nameservice == CORBA_OBJECT_NIL || raised_exception(ev))
-    {
-        ap_log_cerror(APLOG_MARK, APLOG_ERR, 0, ctx->c,
-        "mod_corba: could not obtain reference to "
-        "CORBA nameservice: %s.",
-        (ev->_id) ? ev->_id : "Unknown error");
-        CORBA_exception_free(ev);
-        return 0;	
-    }
-    
-    
-    /* get IOR strings for all registred objects */
-    ctx->nameservice = nameservice;
+    if (shared == NULL)
+        return APR_SUCCESS;
+    admissions = &local_admissions;
+    limits_release(adm);
+    limits_release(&local_admissions);
+    if (adm != &local_admissions)
+        apr_atomic_set32(&adm->pid, 0);
+    return APR_SUCCESS;
+}
 
-    ap_log_cerror(APLOG_MARK, APLOG_DEBUG, 0, ctx->c,
-        "ior_cache_fill()->get_iors_from_nameservice");
+/**
+ * Monitor hook, run periodically in parent. Admissions of children which
+ * died without running their cleanup (crash, kill) are returned to limits.
+ *
+ * @param p   Pool of parent.
+ * @param s   Main server.
+ * @return    Always DECLINED.
+ */
+#if AP_MODULE_MAGIC_AT_LEAST(20111130, 0)
+static int corba_monitor(__attribute__((unused)) apr_pool_t *p, server_rec *s)
+#else
+static int corba_monitor(__attribute__((unused)) apr_pool_t *p)
+#endif
+{
+#if !AP_MODULE_MAGIC_AT_LEAST(20111130, 0)
+    server_rec  *s = NULL;
+#endif
+    apr_uint32_t pid;
+    int          i;
 
-    apr_table_do(get_ior_from_nameservice, pctx, sc->objects, NULL);
-    
-    /* release nameservice */
-    CORBA_Object_release(nameservice, ev);
-    if (raised_exception(ev))
-    {
-        ap_log_cerror(APLOG_MARK, APLOG_ERR, 0, ctx->c,
-        "mod_corba: error when releasing nameservice's "
-    	"reference: %s.", ev->_id);
-        CORBA_exception_free(ev);
+    for (i = 0; shared != NULL && i < CHILD_SLOTS; i++) {
+        admissions_t *adm = &shared->children[i];
+
+        if ((pid = apr_atomic_read32(&adm->pid)) == 0)
+            continue;
+        if (kill((pid_t) pid, 0) == 0 || errno != ESRCH)
+            continue;
+        limits_release(adm);
+        apr_atomic_set32(&adm->pid, 0);
+        ap_log_error(APLOG_MARK, APLOG_NOTICE, 0, s,
+            "mod_corba: admissions of dead child %u reclaimed", pid);
     }
+    return DECLINED;
+}
 
-    ap_log_cerror(APLOG_MARK, APLOG_DEBUG, 0, ctx->c,
-        "return from ior_cache_fill()");
+/**
+ * Function locks cache mutex and records time spent waiting for it.
+ */
+static void cache_lock(void)
+{
+#if APR_HAS_THREADS
+    apr_time_t start = apr_time_now();
 
-    return (apr_table_elts(sc->objects) == apr_table_elts(cache->iors));
+    apr_thread_mutex_lock(cache->mutex);
+    if (shared != NULL)
+        stats_latency(shared->stats.lock_wait_hist,
+                &shared->stats.lock_wait_max, apr_time_now() - start);
+#endif
 }
 
 /**
- * Function obtains one reference from IOR string and sticks the
- * reference to connection.
+ * Function unlocks cache mutex.
+ */
+static void cache_unlock(void)
+{
+#if APR_HAS_THREADS
+    apr_thread_mutex_unlock(cache->mutex);
+#endif
+}
+
+/**
+ * Function records reference of object held by connection of child.
  *
- * @param pctx    Context pointer.
- * @param alias   Alias of object.
- * @param name    Name of object.
- * @return        1 if successfull, 0 in case of failure.
+ * @param alias     Alias of object.
  */
-static int get_reference_from_ior(void *pctx, const char *alias, __attribute__((unused)) const char *name)
+static void backend_ref(const char *alias)
 {
-    void                            *service;
-    CORBA_Environment                ev[1];
-    struct reference_cleanup_arg    *cleanup_arg;
-    const char                      *ior;
-    
-    struct get_reference_ctx *ctx = pctx;
-   
-    CORBA_exception_init(ev);
+    backend_t *b;
 
-    /**
-     * Try cache then nameservice (also overwrite cache for futher use)
-     * if nameservice is unavailable retry 3 times then fails.
-     */
-    unsigned n = 3;
-    while (n > 0) {
-        ior = apr_table_get(cache->iors, alias);
-        if (!ior) {
-            ior_cache_fill(pctx);
-        }
-        else {
-            ap_log_cerror(APLOG_MARK, APLOG_DEBUG, 0, ctx->c,
-			"mod_corba: cache hit!");
-            /* try translate IOR string to reference */
-            service = CORBA_ORB_string_to_object(ctx->orb, ior, ev);
-  
-	        if (service == CORBA_OBJECT_NIL || raised_exception(ev)) {
-	        	ap_log_cerror(APLOG_MARK, APLOG_ERR, 0, ctx->c,
-	        		"mod_corba: Could not obtain reference of "
-	        		"object alias '%s' from IOR '%s': %s.", alias, ior,
-	        		(ev->_id) ? ev->_id : "Unknown error");
-	        	CORBA_exception_free(ev);
-	        	return 0;
-	        }
-            break;
-        }
-        --n;
-    }
-    if (!ior) {
-        ap_log_cerror(APLOG_MARK, APLOG_ERR, 0, ctx->c,
-			"mod_corba: Could not obtain reference neither from cache nor "
-            "nameservice.");
-        return 1;
+    if (cache == NULL)
+        return;
+    cache_lock();
+    b = apr_hash_get(cache->backends, alias, APR_HASH_KEY_STRING);
+    if (b == NULL) {
+        b = apr_pcalloc(cache->backend_pool, sizeof *b);
+        b->alias = apr_pstrdup(cache->backend_pool, alias);
+        b->lim   = (limits != NULL) ?
+            apr_hash_get(limits, alias, APR_HASH_KEY_STRING) : NULL;
+        apr_hash_set(cache->backends, b->alias, APR_HASH_KEY_STRING, b);
     }
-    
-	/* register cleanup routine for reference */
-	cleanup_arg = apr_palloc(ctx->c->pool, sizeof *cleanup_arg);
-	cleanup_arg->c       = ctx->c;
-	cleanup_arg->alias   = alias;
-	cleanup_arg->service = service;
-	apr_pool_cleanup_register(ctx->c->pool, cleanup_arg, reference_cleanup,
-			apr_pool_cleanup_null);
+    b->refs++;
+    cache_unlock();
+}
 
-	/* save object in connection notes */
-	apr_hash_set(ctx->objects, alias, strlen(alias), service);
+/**
+ * Function finds out whether GIOP connection is used by another connected
+ * object. Cache mutex must be held by caller.
+ *
+ * @param b     Object which is not taken into account.
+ * @param cnx   GIOP connection.
+ * @return      1 if the connection is shared, 0 otherwise.
+ */
+static int backend_endpoint_shared(const backend_t *b,
+        const ORBitConnection *cnx)
+{
+    apr_hash_index_t *hi;
 
-	ap_log_cerror(APLOG_MARK, APLOG_DEBUG, 0, ctx->c,
-		"mod_corba: reference for alias '%s', belonging to "
-		"connection %ld was obtained from IOR.", alias, ctx->c->id);
+    for (hi = apr_hash_first(NULL, cache->backends); hi;
+            hi = apr_hash_next(hi)) {
+        void *val;
 
-	return 1;
+        apr_hash_this(hi, NULL, NULL, &val);
+        if (val != b && ((backend_t *) val)->connected &&
+            ((backend_t *) val)->cnx == cnx)
+            return 1;
+    }
+    return 0;
 }
 
+/**
+ * Function marks GIOP connection of object as closed. Socket of child is
+ * released when no other object uses the same connection. Cache mutex must
+ * be held by caller.
+ *
+ * @param b   Object.
+ * @return    Reference of GIOP connection held by object, caller releases
+ *            it after the mutex is unlocked (NULL = none).
+ */
+static ORBitConnection *backend_closed(backend_t *b)
+{
+    ORBitConnection *cnx = b->cnx;
+
+    b->connected = 0;
+    b->cnx       = NULL;
+    if (cnx != NULL && !backend_endpoint_shared(b, cnx))
+        cache->sockets--;
+    if (b->lim != NULL)
+        limit_socket_close(b->lim);
+    return cnx;
+}
 
 /**
- * Connection handler.
+ * Function records release of reference of object held by connection of
+ * child. ORBit closes GIOP connection of object when its last reference is
+ * released.
  *
- * Connection handler obtains object references from IOR string for
- * configured objects. These object references are sticked to connection
- * for later use by other modules. Cleanup routine which handles
- * reference's release is bound to connection.
+ * @param alias     Alias of object.
+ */
+static void backend_unref(const char *alias)
+{
+    backend_t       *b;
+    ORBitConnection *cnx = NULL;
+
+    if (cache == NULL)
+        return;
+    cache_lock();
+    b = apr_hash_get(cache->backends, alias, APR_HASH_KEY_STRING);
+    if (b != NULL && b->refs > 0 && --b->refs == 0 && b->connected)
+        cnx = backend_closed(b);
+    cache_unlock();
+    if (cnx != NULL)
+        ORBit_small_connection_unref(cnx);
+}
+
+/**
+ * Function records GIOP connection used by calls of object, so that
+ * sockets of child are counted per endpoint (ORBit shares one connection
+ * among objects of the same server). The connection is looked up without
+ * cache mutex, as ORBit opens it (and waits for it) if it is not open.
  *
- * @param c   Incoming connection.
- * @return    Return code
+ * @param b        Object.
+ * @param object   Object called by caller.
  */
-static int corba_process_connection(conn_rec *c)
+static void backend_attach(backend_t *b, CORBA_Object object)
 {
-    char    ns_string[150];
-    CORBA_Environment   ev[1];
-    CosNaming_NamingContext nameservice;
-    
-	struct get_reference_ctx	ctx;
-	
-    server_rec  *s = c->base_server;
-	corba_conf  *sc = (corba_conf *)
-		ap_get_module_config(s->module_config, &corba_module);
+    ORBitConnection *cnx;
 
-    ap_log_cerror(APLOG_MARK, APLOG_DEBUG, 0, c,
-        "call corba_process_connection()");
+    if (object == CORBA_OBJECT_NIL ||
+        (cnx = ORBit_small_get_connection_ref(object)) == NULL)
+        return;
+    cache_lock();
+    if (b->connected && b->cnx == NULL) {
+        if (!backend_endpoint_shared(b, cnx))
+            cache->sockets++;
+        b->cnx = cnx;
+        cnx    = NULL;
+    }
+    cache_unlock();
+    if (cnx != NULL)
+        ORBit_small_connection_unref(cnx);
+}
 
-	/* do nothing if corba is disabled */
-	if (!sc->enabled)
-		return DECLINED;
+/**
+ * Function records start of call of object. GIOP connection is opened by
+ * first call of object, it is counted against CorbaMaxBackendSockets of
+ * the object.
+ *
+ * @param alias     Alias of object.
+ * @param object    Object called by caller.
+ * @return          1 if the call may be made, 0 otherwise.
+ */
+static int backend_use(const char *alias, CORBA_Object object)
+{
+    backend_t      *b;
+    int             attach;
 
-    /* init ctx structure and obtain references for all configured objects */
-    ctx.c       = c;
-    ctx.orb     = sc->orb;
-    ctx.objects = apr_hash_make(c->pool);
+    if (cache == NULL)
+        return 1;
+    cache_lock();
+    b = apr_hash_get(cache->backends, alias, APR_HASH_KEY_STRING);
+    if (b == NULL || b->refs == 0) {
+        cache_unlock();
+        return 1;
+    }
+    if (!b->connected) {
+        if (b->lim != NULL && !limit_socket_open(b->lim)) {
+            cache_unlock();
+            return 0;
+        }
+        b->connected = 1;
+    }
+    b->last_used = apr_time_now();
+    b->inflight++;
+    attach = (b->cnx == NULL);
+    cache_unlock();
 
-    /* if IOR caching is enabled */
-	if (sc->ior_cache_enabled && cache != NULL) {
-#if APR_HAS_THREADS
-        apr_thread_mutex_lock(cache->mutex);
-#endif
-        apr_table_do(get_reference_from_ior, (void *) &ctx, sc->objects, NULL);
-#if APR_HAS_THREADS
-        apr_thread_mutex_unlock(cache->mutex);
-#endif
-        ap_set_module_config(c->conn_config, &corba_module, ctx.objects);
-        return DECLINED;
+    /* backends are never freed, b stays valid without mutex */
+    if (attach)
+        backend_attach(b, object);
+    return 1;
+}
+
+/**
+ * Function records end of call of object started by backend_use().
+ *
+ * @param alias     Alias of object.
+ * @param object    Object called by caller.
+ */
+static void backend_done(const char *alias, CORBA_Object object)
+{
+    backend_t      *b;
+    int             attach;
+
+    if (cache == NULL)
+        return;
+    cache_lock();
+    b = apr_hash_get(cache->backends, alias, APR_HASH_KEY_STRING);
+    if (b == NULL || b->refs == 0) {
+        cache_unlock();
+        return;
     }
+    if (b->inflight > 0)
+        b->inflight--;
+    b->last_used = apr_time_now();
+    attach = (b->connected && b->cnx == NULL);
+    cache_unlock();
 
-    /* if IOR cache is NOT enabled handle it in old way (nameservice call) */
-	ns_string[149] = 0;
-	snprintf(ns_string, 149, "corbaloc::%s/NameService", sc->ns_loc);
-	CORBA_exception_init(ev);
-	nameservice = (CosNaming_NamingContext)
-        	CORBA_ORB_string_to_object(sc->orb, ns_string, ev);
-	
-    if (nameservice == CORBA_OBJECT_NIL || raised_exception(ev))
-	{
-		ap_log_cerror(APLOG_MARK, APLOG_ERR, 0, c,
-			"mod_corba: could not obtain reference to "
-       		"CORBA nameservice: %s.",
-       		(ev->_id) ? ev->_id : "Unknown error");
-       	CORBA_exception_free(ev);
-       	return DECLINED;
-	}
+    /* connection was not open yet when the call started */
+    if (attach)
+        backend_attach(b, object);
+}
 
-    ctx.nameservice = nameservice;	
-	apr_table_do(get_reference_from_nameservice, (void *) &ctx, sc->objects, NULL);
-    
-	/* bind hash table of object references to conn_rec */
-	ap_set_module_config(c->conn_config, &corba_module, ctx.objects);
-   
-    /* release nameservice */
-    CORBA_Object_release(nameservice, ev);
-    if (raised_exception(ev))
-    {
-        ap_log_cerror(APLOG_MARK, APLOG_ERR, 0, c,
-        "mod_corba: error when releasing nameservice's "
-    	"reference: %s.", ev->_id);
-        CORBA_exception_free(ev);
+/**
+ * Function records start of call which is not made on behalf of
+ * a connection (nameservice, liveness probe). GIOP connection used by the
+ * call is not closed as idle while the call is in flight. Last use of
+ * objects is not changed by the call.
+ *
+ * @param object   Called object.
+ * @return         GIOP connection to be passed to backend_other_end()
+ *                 (NULL = not tracked).
+ */
+static ORBitConnection *backend_other_begin(CORBA_Object object)
+{
+    ORBitConnection *cnx;
+
+    if (cache == NULL || object == CORBA_OBJECT_NIL ||
+        (cnx = ORBit_small_get_connection_ref(object)) == NULL)
+        return NULL;
+    cache_lock();
+    APR_ARRAY_PUSH(cache->other_calls, ORBitConnection *) = cnx;
+    cache_unlock();
+    return cnx;
+}
+
+/**
+ * Function records end of call started by backend_other_begin().
+ *
+ * @param cnx   GIOP connection returned by backend_other_begin().
+ */
+static void backend_other_end(ORBitConnection *cnx)
+{
+    ORBitConnection **calls;
+    int               i;
+
+    if (cnx == NULL)
+        return;
+    cache_lock();
+    calls = (ORBitConnection **) cache->other_calls->elts;
+    for (i = 0; i < cache->other_calls->nelts; i++) {
+        if (calls[i] == cnx) {
+            calls[i] = calls[--cache->other_calls->nelts];
+            break;
+        }
+    }
+    cache_unlock();
+    ORBit_small_connection_unref(cnx);
+}
+
+/**
+ * Function asks for admission of call of object. The call is subject to
+ * CorbaMaxConcurrent and CorbaMaxBackendSockets of the object. The function
+ * is exported for modules which use the references, admitted call must be
+ * finished by corba_call_end().
+ *
+ * @param alias    Alias of object.
+ * @param object   Reference of object which is called.
+ * @return         1 if the call was admitted, 0 if it was rejected.
+ */
+static int corba_call_begin(const char *alias, void *object)
+{
+    if (!limit_enter(alias))
+        return 0;
+    if (!backend_use(alias, (CORBA_Object) object)) {
+        limit_leave(alias);
+        return 0;
     }
+    return 1;
+}
+
+/**
+ * Function finishes call admitted by corba_call_begin(). The function is
+ * exported for modules which use the references.
+ *
+ * @param alias    Alias of object.
+ * @param object   Reference of object which was called.
+ */
+static void corba_call_end(const char *alias, void *object)
+{
+    backend_done(alias, (CORBA_Object) object);
+    limit_leave(alias);
+}
+
+
+#if AP_SERVER_MINORVERSION_NUMBER == 0
+/**
+ * ap_log_cerror is defined only if apache version is 2.0 because 2.0
+ * contrary to 2.2 does not have this function.
+ */
+#define ap_log_cerror(mark, level, status, c, ...) \
+	ap_log_error(mark, level, status, (c)->base_server, __VA_ARGS__)
+#endif
+
+/** Quick test if corba exception was raised. */
+#define raised_exception(ev)    ((ev)->_major != CORBA_NO_EXCEPTION)
+
+/** Number of bindings obtained from nameservice by one list() call. */
+#define CONTEXT_LIST_BATCH      64
+
+/**
+ * This structure is passed to reference cleanup routine.
+ *
+ * We pass also the connection id in order to track references when
+ * debug log is enabled.
+ */
+struct reference_cleanup_arg {
+	void            *service;
+	const conn_rec  *c;
+	const char      *alias;
+};
+
+/**
+ * Cleanup routine releases corba object reference.
+ *
+ * This routine is called upon destroying connection pool.
+ *
+ * @param object  The object reference.
+ */
+static apr_status_t reference_cleanup(void *raw_arg)
+{
+	CORBA_Environment ev[1];
+	struct reference_cleanup_arg *arg = raw_arg;
+
+	CORBA_exception_init(ev);
+
+	/* releasing managed object */
+	STATS_DEC(references);
+	backend_unref(arg->alias);
+	CORBA_Object_release(arg->service, ev);
+	if (raised_exception(ev)) {
+		ap_log_cerror(APLOG_MARK, APLOG_ERR, 0, arg->c,
+			"mod_corba: error when releasing corba object: %s.",
+			ev->_id);
+		return APR_EGENERAL;
+	}
+	CORBA_exception_free(ev);
+
+	ap_log_cerror(APLOG_MARK, APLOG_DEBUG, 0, arg->c,
+		"mod_corba: reference with alias '%s', belonging to "
+		"connection %ld was released.", arg->alias, arg->c->id);
+	return APR_SUCCESS;
+}
+
+/** 
+ * Context structure passed between get_reference_from_() and connection
+ * handler. 
+ */
+struct get_reference_ctx {
+	conn_rec	               *c;             /**< Current connection. */
+    apr_pool_t                 *pool;          /**< Pool for references and their cleanups. */
+    CORBA_ORB                   orb;           /**< Orb. */
+	apr_hash_t	               *objects;       /**< Hash table of object references. */
+    CosNaming_NamingContext     nameservice;   /**< Corba nameservice. */
+    ior_gen_t                  *gen;           /**< Referenced generation of IOR cache. */
+    const corba_conf           *sc;            /**< Configuration of server. */
+};
+
+/** 
+ * Context structure passed between get_ior_from_nameservice() and post config
+ * hook. 
+ */
+//struct get_ior_ctx {
+//    server_rec                 *s;               /**< Current server. */
+//    CORBA_ORB                   orb;             /**< Orb. */
+//    apr_table_t                *ior_cache;       /**< Table for storing pair alias-IOR.*/
+//    CosNaming_NamingContext     nameservice;     /**< Corba nameservice. */
+//};
+
+
+/**
+ * Function returns reference from nameservice for object given by name
+ *
+ * @param s            Server record (used for logging).
+ * @param pool         Pool used for temporary allocations.
+ * @param nameservice  Corba nameservice.
+ * @param name         Name of object.
+ * @return             service if successfull, NULL in case of failure.
+ */
+static void* get_reference_for_service(server_rec *s, apr_pool_t *pool,
+        CosNaming_NamingContext nameservice, const char *name)
+{
+    void    *service;
+    const char  *p;
+    CORBA_Environment   ev[1];
+    CosNaming_Name  cos_name;
+    CosNaming_NameComponent name_component[2] = { {NULL, "context"},
+        {NULL, "Object"} };
+    apr_time_t  start;
+    ORBitConnection *call;
+    
+    ap_log_error(APLOG_MARK, APLOG_DEBUG, 0, s,
+            "call get_reference_for_service(%s)", name);
+
+    /* divide name in two parts - context and object's name */
+    for (p = name; *p != '\0'; p++) {
+        if (*p == '.') break;
+    }
+    if (*p == '\0') {
+        name_component[0].id = apr_pstrdup(pool, CONTEXT_NAME);
+        name_component[1].id = (char *) name;
+    }
+    else {
+        name_component[0].id = apr_pstrmemdup(pool, name, p - name);
+        name_component[1].id = apr_pstrdup(pool, p + 1);
+    }
+    cos_name._maximum = cos_name._length = 2;
+    cos_name._buffer = name_component;
+    
+    /* get object's reference */ 
+    CORBA_exception_init(ev);
+    call  = backend_other_begin(nameservice);
+    start = apr_time_now();
+    service = CosNaming_NamingContext_resolve(nameservice, &cos_name, ev);
+    corba_call_record("NameService", "resolve", apr_time_now() - start,
+            raised_exception(ev));
+    backend_other_end(call);
+    STATS_INC(resolves);
+    if (service == CORBA_OBJECT_NIL || raised_exception(ev)) {
+        STATS_INC(resolve_errors);
+        ap_log_error(APLOG_MARK, APLOG_ERR, 0, s,
+            "mod_corba: Could not obtain reference of "
+            "object '%s': %s.", name,
+            (ev->_id) ? ev->_id : "Unknown error");
+        CORBA_exception_free(ev);
+        return NULL;
+    }
+    
+    return service;
+}
+
+/**
+ * Function decides whether an object discovered in context is used by
+ * server. Explicitly configured objects take precedence and the object
+ * must be in scope of server.
+ *
+ * @param sc     Server configuration.
+ * @param alias  Alias of discovered object.
+ * @return       1 if object is used by server, 0 otherwise.
+ */
+static int context_object_wanted(const corba_conf *sc, const char *alias)
+{
+    return apr_table_get(sc->objects, alias) == NULL &&
+           corba_object_in_scope(sc, alias);
+}
+
+/**
+ * Function adds objects from list of bindings to table of discovered
+ * objects. Alias of object is the name under which it is bound in context.
+ * All bindings are added, the table is shared by all servers using the
+ * context, which filter it by context_object_wanted().
+ *
+ * @param pool     Pool used for allocation of table entries.
+ * @param objects  Table of discovered objects alias - name.
+ * @param context  Name of context.
+ * @param bl       List of bindings.
+ */
+static void add_context_bindings(apr_pool_t *pool, apr_table_t *objects,
+        const char *context, const CosNaming_BindingList *bl)
+{
+    CORBA_unsigned_long i;
+
+    for (i = 0; i < bl->_length; i++) {
+        const CosNaming_Binding *b = &bl->_buffer[i];
+        const char *alias;
+
+        if (b->binding_type != CosNaming_nobject ||
+            b->binding_name._length != 1)
+            continue;
+        alias = b->binding_name._buffer[0].id;
+        apr_table_set(objects, alias,
+                apr_pstrcat(pool, context, ".", alias, NULL));
+    }
+}
+
+/**
+ * Function discovers all objects bound in given context of nameservice.
+ * Bindings are obtained by a single list() call, the binding iterator is
+ * used only for contexts with more than CONTEXT_LIST_BATCH bindings.
+ *
+ * @param s            Server record (used for logging).
+ * @param pool         Pool used for allocation of returned table.
+ * @param nameservice  Corba nameservice.
+ * @param context      Name of context.
+ * @return             Table alias - name, NULL in case of failure.
+ */
+static apr_table_t *list_context_objects(server_rec *s, apr_pool_t *pool,
+        CosNaming_NamingContext nameservice, const char *context)
+{
+    CORBA_Environment           ev[1];
+    CosNaming_NamingContext     naming_context;
+    ORBitConnection            *call;
+    CosNaming_BindingList      *bl;
+    CosNaming_BindingIterator   bi;
+    CosNaming_Name              cos_name;
+    CosNaming_NameComponent     name_component[1] = { {NULL, "context"} };
+    apr_table_t                *objects;
+    apr_time_t                  start;
+
+    ap_log_error(APLOG_MARK, APLOG_DEBUG, 0, s,
+            "call list_context_objects(%s)", context);
+
+    name_component[0].id = (char *) context;
+    cos_name._maximum = cos_name._length = 1;
+    cos_name._buffer = name_component;
+
+    CORBA_exception_init(ev);
+    /* calls of context and iterator go to the server of nameservice */
+    call  = backend_other_begin(nameservice);
+    start = apr_time_now();
+    naming_context = CosNaming_NamingContext_resolve(nameservice, &cos_name, ev);
+    corba_call_record("NameService", "resolve", apr_time_now() - start,
+            raised_exception(ev));
+    if (naming_context == CORBA_OBJECT_NIL || raised_exception(ev)) {
+        ap_log_error(APLOG_MARK, APLOG_ERR, 0, s,
+            "mod_corba: Could not obtain reference of "
+            "context '%s': %s.", context,
+            (ev->_id) ? ev->_id : "Unknown error");
+        CORBA_exception_free(ev);
+        backend_other_end(call);
+        return NULL;
+    }
+
+    start = apr_time_now();
+    CosNaming_NamingContext_list(naming_context, CONTEXT_LIST_BATCH,
+            &bl, &bi, ev);
+    corba_call_record("NameService", "list", apr_time_now() - start,
+            raised_exception(ev));
+    if (raised_exception(ev)) {
+        ap_log_error(APLOG_MARK, APLOG_ERR, 0, s,
+            "mod_corba: Could not list objects of "
+            "context '%s': %s.", context,
+            (ev->_id) ? ev->_id : "Unknown error");
+        CORBA_exception_free(ev);
+        CORBA_Object_release(naming_context, ev);
+        CORBA_exception_free(ev);
+        backend_other_end(call);
+        return NULL;
+    }
+
+    objects = apr_table_make(pool, CONTEXT_LIST_BATCH);
+    add_context_bindings(pool, objects, context, bl);
+    CORBA_free(bl);
+
+    /* the rest of bindings of large context */
+    if (bi != CORBA_OBJECT_NIL) {
+        CORBA_boolean more;
+
+        do {
+            start = apr_time_now();
+            more = CosNaming_BindingIterator_next_n(bi, CONTEXT_LIST_BATCH,
+                    &bl, ev);
+            corba_call_record("NameService", "next_n",
+                    apr_time_now() - start, raised_exception(ev));
+            if (raised_exception(ev)) {
+                ap_log_error(APLOG_MARK, APLOG_ERR, 0, s,
+                    "mod_corba: Could not iterate objects of "
+                    "context '%s': %s.", context,
+                    (ev->_id) ? ev->_id : "Unknown error");
+                CORBA_exception_free(ev);
+                break;
+            }
+            add_context_bindings(pool, objects, context, bl);
+            CORBA_free(bl);
+        } while (more);
+
+        CosNaming_BindingIterator_destroy(bi, ev);
+        CORBA_exception_free(ev);
+        CORBA_Object_release(bi, ev);
+        CORBA_exception_free(ev);
+    }
+    CORBA_Object_release(naming_context, ev);
+    CORBA_exception_free(ev);
+    backend_other_end(call);
+
+    ap_log_error(APLOG_MARK, APLOG_DEBUG, 0, s,
+            "mod_corba: %d object(s) discovered in context '%s'",
+            apr_table_elts(objects)->nelts, context);
+
+    return objects;
+}
+
+/**
+ * Function obtains one reference from corba nameservice and sticks the
+ * reference to connection.
+ *
+ * @param pctx    Context pointer.
+ * @param alias   Alias of object.
+ * @param name    Name of object.
+ * @return        1 if successfull, 0 in case of failure.
+ */
+static int get_reference_from_nameservice(void *pctx, const char *alias, const char *name)
+{
+    struct get_reference_ctx *ctx = pctx;
+     ap_log_cerror(APLOG_MARK, APLOG_DEBUG, 0, ctx->c,
+            "call get_reference_from_nameservice(%s, %s)", alias, name);
+   
+    void *service = (void *) get_reference_for_service(ctx->c->base_server,
+            ctx->pool, ctx->nameservice, name);
+    if (service == NULL) {
+        return 0;
+    }
+    
+    struct reference_cleanup_arg    *cleanup_arg;
+
+    /* register cleanup routine for reference */
+    cleanup_arg = apr_palloc(ctx->pool, sizeof *cleanup_arg);
+    cleanup_arg->c       = ctx->c;
+    cleanup_arg->alias   = alias;
+    cleanup_arg->service = service;
+    apr_pool_cleanup_register(ctx->pool, cleanup_arg, reference_cleanup,
+            apr_pool_cleanup_null);
+    STATS_INC(references);
+    backend_ref(alias);
+
+    /* save object in connection notes */
+    apr_hash_set(ctx->objects, alias, strlen(alias), service);
+    
+    ap_log_cerror(APLOG_MARK, APLOG_DEBUG, 0, ctx->c,
+        "mod_corba: reference '%s' with alias '%s', belonging to "
+        "connection %ld was obtained from corba nameservice.", name, alias, ctx->c->id);
+
+    return 1;
+}
+
+
+/**
+ * One object resolved during IOR cache fill.
+ */
+struct resolve_job {
+    const char     *alias;      /**< Alias of object. */
+    const char     *name;       /**< Name of object. */
+    CORBA_char     *ior;        /**< IOR string, NULL if resolution failed. */
+};
+
+/**
+ * Context structure shared by all threads resolving objects during IOR cache
+ * fill.
+ */
+struct resolve_ctx {
+    server_rec                 *s;             /**< Server (used for logging). */
+    CORBA_ORB                   orb;           /**< Orb. */
+    CosNaming_NamingContext     nameservice;   /**< Corba nameservice. */
+    struct resolve_job         *jobs;          /**< Objects to resolve. */
+    apr_uint32_t                njobs;         /**< Number of objects. */
+    volatile apr_uint32_t       next;          /**< Index of next unclaimed job. */
+};
+
+/**
+ * Function obtains IOR string for one object registered in mod_corba and
+ * stores it in the job structure.
+ *
+ * @param rctx    Resolve context.
+ * @param pool    Pool used for temporary allocations.
+ * @param job     Object to resolve.
+ */
+static void get_ior_from_nameservice(struct resolve_ctx *rctx, apr_pool_t *pool,
+        struct resolve_job *job)
+{
+    CORBA_Environment   ev[1];
+    
+    void *service = get_reference_for_service(rctx->s, pool,
+            rctx->nameservice, job->name);
+    if (service == NULL) {
+        return;
+    }
+    
+    CORBA_exception_init(ev);
+    
+    /* translate it to IOR string */
+    job->ior = CORBA_ORB_object_to_string(rctx->orb, service, ev);
+    if (raised_exception(ev)) {
+        ap_log_error(APLOG_MARK, APLOG_ERR, 0, rctx->s,
+            "mod_corba: Could not obtain IOR string from "
+            "object '%s': %s.", job->name,
+            (ev->_id) ? ev->_id : "Unknown error");
+        CORBA_exception_free(ev);
+        job->ior = NULL;
+    }
+    CORBA_Object_release(service, ev);
+    CORBA_exception_free(ev);
+}
+
+/**
+ * Function resolves objects of resolve context until there is no unclaimed
+ * one left. It is run concurrently by all resolving threads.
+ *
+ * @param rctx    Resolve context.
+ * @param pool    Pool used for temporary allocations (private to thread).
+ */
+static void resolve_jobs(struct resolve_ctx *rctx, apr_pool_t *pool)
+{
+    apr_uint32_t    i;
+
+    while ((i = apr_atomic_inc32(&rctx->next)) < rctx->njobs) {
+        get_ior_from_nameservice(rctx, pool, &rctx->jobs[i]);
+        apr_pool_clear(pool);
+    }
+}
+
+#if APR_HAS_THREADS
+/**
+ * Argument of resolve_worker() thread.
+ */
+struct resolve_worker_arg {
+    struct resolve_ctx *rctx;   /**< Resolve context. */
+    apr_pool_t         *pool;   /**< Pool private to thread (own allocator). */
+    apr_thread_t       *thread; /**< Thread. */
+};
+
+/**
+ * Thread function resolving objects of resolve context.
+ */
+static void * APR_THREAD_FUNC resolve_worker(apr_thread_t *thd, void *data)
+{
+    struct resolve_worker_arg *arg = data;
+
+    resolve_jobs(arg->rctx, arg->pool);
+    apr_thread_exit(thd, APR_SUCCESS);
+    return NULL;
+}
+#endif
+
+/**
+ * Function resolves all objects of resolve context. Objects are resolved
+ * concurrently by up to nthreads threads (current thread included), so the
+ * time spent is given by the slowest lookup rather than by sum of them.
+ *
+ * Pools of apache are not thread-safe, so each worker thread gets an
+ * unmanaged pool with its own allocator, which is created and destroyed by
+ * the calling thread. Pool passed by caller is used by calling thread only.
+ *
+ * @param rctx      Resolve context.
+ * @param pool      Pool used by calling thread.
+ * @param nthreads  Maximal number of resolving threads.
+ */
+static void resolve_all(struct resolve_ctx *rctx, apr_pool_t *pool, int nthreads)
+{
+    apr_pool_t     *wpool;
+#if APR_HAS_THREADS
+    struct resolve_worker_arg *args;
+    apr_status_t    rv;
+    int             started = 0;
+    int             i;
+
+    if (nthreads > (int) rctx->njobs)
+        nthreads = rctx->njobs;
+    args = apr_pcalloc(pool, (nthreads + 1) * sizeof *args);
+
+    /* current thread is one of the workers */
+    for (i = 1; i < nthreads; i++) {
+        struct resolve_worker_arg *arg = &args[started];
+
+        arg->rctx = rctx;
+        if ((rv = apr_pool_create_unmanaged_ex(&arg->pool, NULL,
+                        NULL)) != APR_SUCCESS) {
+            arg->pool = NULL;
+        }
+        else if ((rv = apr_thread_create(&arg->thread, NULL, resolve_worker,
+                        arg, arg->pool)) != APR_SUCCESS) {
+            apr_pool_destroy(arg->pool);
+            arg->pool = NULL;
+        }
+        if (arg->pool == NULL) {
+            ap_log_error(APLOG_MARK, APLOG_WARNING, rv, rctx->s,
+                "mod_corba: could not start resolving thread, "
+                "continuing with %d thread(s)", started + 1);
+            break;
+        }
+        started++;
+    }
+#endif
+    if (apr_pool_create(&wpool, pool) == APR_SUCCESS) {
+        resolve_jobs(rctx, wpool);
+        apr_pool_destroy(wpool);
+    }
+#if APR_HAS_THREADS
+    for (i = 0; i < started; i++) {
+        apr_thread_join(&rv, args[i].thread);
+        apr_pool_destroy(args[i].pool);
+    }
+#endif
+}
+
+/**
+ * Caching support functions
+ */
+
+/**
+ * Function creates new empty generation of IOR cache. The generation has
+ * its own allocator, so its memory is returned when it is destroyed.
+ *
+ * @return     New generation, NULL in case of failure.
+ */
+static ior_gen_t *ior_gen_create(void)
+{
+    apr_pool_t  *pool;
+    ior_gen_t   *gen;
+
+    if (apr_pool_create_unmanaged_ex(&pool, NULL, NULL) != APR_SUCCESS)
+        return NULL;
+    gen = apr_palloc(pool, sizeof *gen);
+    gen->pool     = pool;
+    gen->iors     = apr_table_make(pool, 5);
+    gen->contexts = apr_hash_make(pool);
+    gen->refs     = 1;
+    return gen;
+}
+
+/**
+ * Function releases one reference of generation and destroys the generation
+ * when it was the last one.
+ *
+ * @param gen  Generation.
+ */
+static void ior_gen_unref(ior_gen_t *gen)
+{
+    if (gen != NULL && !apr_atomic_dec32(&gen->refs))
+        apr_pool_destroy(gen->pool);
+}
+
+/**
+ * Function returns current generation of IOR cache with a reference taken
+ * for caller. Cache mutex must be held by caller.
+ *
+ * @return     Current generation.
+ */
+static ior_gen_t *ior_cache_acquire(void)
+{
+    apr_atomic_inc32(&cache->current->refs);
+    return cache->current;
+}
+
+/**
+ * Function publishes new generation of IOR cache, the previous one is
+ * destroyed once it is not referenced. Cache mutex must be held by caller.
+ *
+ * @param gen  New generation.
+ */
+static void ior_cache_publish(ior_gen_t *gen)
+{
+    ior_gen_t *old = cache->current;
+
+    cache->current = gen;
+    ior_gen_unref(old);
+}
+
+static unsigned flush_slot(const char *alias);
+static void ior_cache_probe_overdue(server_rec *s);
+
+/**
+ * Function copies generation of IOR cache to a new one. Objects and
+ * discovered contexts whose flush slot changed are left out.
+ *
+ * @param src      Copied generation.
+ * @param changed  Changed flush slots, NULL to copy everything.
+ * @return         New generation, NULL in case of failure.
+ */
+static ior_gen_t *ior_gen_copy(const ior_gen_t *src, const int *changed)
+{
+    const apr_array_header_t *elts;
+    const apr_table_entry_t  *entries;
+    apr_hash_index_t         *hi;
+    ior_gen_t                *gen;
+    int                       i;
+
+    if ((gen = ior_gen_create()) == NULL)
+        return NULL;
+
+    elts    = apr_table_elts(src->iors);
+    entries = (const apr_table_entry_t *) elts->elts;
+    for (i = 0; i < elts->nelts; i++) {
+        if (changed == NULL || !changed[flush_slot(entries[i].key)])
+            apr_table_set(gen->iors, entries[i].key, entries[i].val);
+    }
+    for (hi = apr_hash_first(gen->pool, src->contexts); hi;
+            hi = apr_hash_next(hi)) {
+        const void *context;
+        void       *bound;
+        apr_table_t *copy;
+
+        apr_hash_this(hi, &context, NULL, &bound);
+        if (changed != NULL && changed[flush_slot(context)])
+            continue;
+        elts    = apr_table_elts(bound);
+        entries = (const apr_table_entry_t *) elts->elts;
+        copy    = apr_table_make(gen->pool, elts->nelts);
+        for (i = 0; i < elts->nelts; i++)
+            apr_table_set(copy, entries[i].key, entries[i].val);
+        apr_hash_set(gen->contexts, apr_pstrdup(gen->pool, context),
+                APR_HASH_KEY_STRING, copy);
+    }
+    return gen;
+}
+
+/**
+ * Function sets objects of IOR file (see CorbaIORFile) in generation of
+ * IOR cache, they take precedence over objects from nameservice. Cache
+ * mutex must be held by caller.
+ *
+ * @param gen  Generation which is not published yet.
+ */
+static void ior_gen_overlay_file(ior_gen_t *gen)
+{
+    const apr_array_header_t *elts;
+    const apr_table_entry_t  *entries;
+    int                       i;
+
+    if (cache->file_iors == NULL)
+        return;
+    elts    = apr_table_elts(cache->file_iors);
+    entries = (const apr_table_entry_t *) elts->elts;
+    for (i = 0; i < elts->nelts; i++)
+        apr_table_set(gen->iors, entries[i].key, entries[i].val);
+}
+
+/**
+ * Function deletes whole cache by publishing a generation with objects of
+ * IOR file only. Refill of the cache happens on next access of each
+ * object. Cache mutex must be held by caller.
+ */
+static void ior_cache_garbage(void) {
+    ior_gen_t *gen = ior_gen_create();
+
+    if (gen != NULL) {
+        ior_gen_overlay_file(gen);
+        ior_cache_publish(gen);
+    }
+}
+
+/**
+ * Function returns slot of per-alias flush generation for given alias
+ * (or context name).
+ *
+ * @param alias   Alias of object.
+ * @return        Index of slot.
+ */
+static unsigned flush_slot(const char *alias)
+{
+    unsigned hash = 5381;
+
+    while (*alias != '\0')
+        hash = hash * 33 + (unsigned char) *alias++;
+    return hash % FLUSH_SLOTS;
+}
+
+/**
+ * Function synchronizes cache of child with flushes requested through
+ * corba-admin handler in any child. If the whole cache was flushed, it is
+ * deleted, otherwise only objects (and discovered contexts) whose slot
+ * generation changed are removed from the cache. They are resolved again on
+ * their next access, objects of IOR file stay in the cache. Cache mutex
+ * must be held by caller.
+ *
+ * @param c   Current connection.
+ */
+static void ior_cache_sync(conn_rec *c)
+{
+    ior_gen_t                *gen;
+    apr_uint32_t              generation;
+    apr_uint32_t              flushes;
+    int                       changed[FLUSH_SLOTS];
+    int                       any = 0;
+    int                       i;
+
+    if (shared == NULL)
+        return;
+
+    generation = apr_atomic_read32(&shared->generation);
+    flushes    = apr_atomic_read32(&shared->flushes);
+    if (generation == cache->generation && flushes == cache->flushes)
+        return;
+
+    for (i = 0; i < FLUSH_SLOTS; i++) {
+        apr_uint32_t g = apr_atomic_read32(&shared->alias_generation[i]);
+
+        changed[i] = (g != cache->alias_generation[i]);
+        any |= changed[i];
+        cache->alias_generation[i] = g;
+    }
+    cache->flushes = flushes;
+
+    if (generation != cache->generation) {
+        cache->generation = generation;
+        ior_cache_garbage();
+        ap_log_cerror(APLOG_MARK, APLOG_INFO, 0, c,
+            "mod_corba: IOR cache flushed (generation %u)", generation);
+        return;
+    }
+    if (!any)
+        return;
+
+    if ((gen = ior_gen_copy(cache->current, changed)) == NULL)
+        return;
+    ior_gen_overlay_file(gen);
+    ap_log_cerror(APLOG_MARK, APLOG_INFO, 0, c,
+        "mod_corba: %d object(s) flushed from IOR cache",
+        apr_table_elts(cache->current->iors)->nelts -
+        apr_table_elts(gen->iors)->nelts);
+    ior_cache_publish(gen);
+}
+
+/**
+ * Function claims resolution of object (or listing of context) for calling
+ * connection, so that concurrent connections do not repeat it. Cache mutex
+ * must be held by caller.
+ *
+ * @param inflight  Objects (or contexts) being resolved.
+ * @param key       Alias of object (or name of context).
+ * @return          1 if claimed, 0 if it is being resolved by someone else.
+ */
+static int ior_cache_claim(apr_hash_t *inflight, const char *key)
+{
+    if (apr_hash_get(inflight, key, APR_HASH_KEY_STRING) != NULL)
+        return 0;
+    apr_hash_set(inflight, key, APR_HASH_KEY_STRING, key);
+    return 1;
+}
+
+/**
+ * Function fills IOR cache with IOR strings configured for given server.
+ * Only objects (and contexts) which are not being resolved by another
+ * connection are claimed and resolved, in parallel (see
+ * CorbaResolveThreads). Cache mutex is held by caller, it is released while
+ * nameservice is contacted. Results are stored in a copy of current
+ * generation which is then published, unless the cache was flushed
+ * meanwhile. Waiting connections are woken up afterwards.
+ *
+ * @param pctx  Context pointer.
+ * @return      1 if successfull, 0 in case of failure.
+ */
+static int ior_cache_fill(void *pctx) {
+	CORBA_Environment	    ev[1];
+    CosNaming_NamingContext nameservice;
+    char	                ns_string[150];
+    apr_pool_t             *pool;
+    ior_gen_t              *gen;
+    apr_array_header_t     *contexts;
+    apr_array_header_t     *jobs;
+    apr_table_t           **listed;
+    const apr_array_header_t *elts;
+    const apr_table_entry_t  *entries;
+    struct resolve_ctx      rctx;
+    apr_uint32_t            generation;
+    apr_uint32_t            flushes;
+    int                     i, j;
+    int                     failed = 0;
+    
+    struct get_reference_ctx *ctx = pctx;
+   
+    server_rec  *s  = ctx->c->base_server;
+    corba_conf  *sc = (corba_conf *)
+		ap_get_module_config(s->module_config, &corba_module);
+
+    ap_log_cerror(APLOG_MARK, APLOG_DEBUG, 0, ctx->c,
+        "call ior_cache_fill()");
+
+    if (apr_pool_create(&pool, ctx->pool) != APR_SUCCESS)
+        return 0;
+    STATS_INC(fills);
+
+    /* claim contexts and objects nobody else is resolving */
+    generation = cache->generation;
+    flushes    = cache->flushes;
+    contexts   = apr_array_make(pool, sc->contexts->nelts, sizeof(const char *));
+    for (i = 0; i < sc->contexts->nelts; i++) {
+        const char *context = APR_ARRAY_IDX(sc->contexts, i, const char *);
+
+        if (ior_cache_claim(cache->inflight_contexts, context))
+            APR_ARRAY_PUSH(contexts, const char *) = context;
+    }
+    elts    = apr_table_elts(sc->objects);
+    entries = (const apr_table_entry_t *) elts->elts;
+    jobs    = apr_array_make(pool, elts->nelts, sizeof(struct resolve_job));
+    for (i = 0; i < elts->nelts; i++) {
+        struct resolve_job *job;
+
+        if (!ior_cache_claim(cache->inflight, entries[i].key))
+            continue;
+        job = &APR_ARRAY_PUSH(jobs, struct resolve_job);
+        job->alias = entries[i].key;
+        job->name  = entries[i].val;
+        job->ior   = NULL;
+    }
+    listed = apr_pcalloc(pool, (contexts->nelts + 1) * sizeof *listed);
+    cache_unlock();
+
+    /* do initialization of corba */
+	CORBA_exception_init(ev);
+
+    /* get nameservice's reference */
+    ns_string[149] = 0;
+    snprintf(ns_string, 149, "corbaloc::%s/NameService", sc->ns_loc);
+    
+    nameservice = (CosNaming_NamingContext)
+        CORBA_ORB_string_to_object(ctx->orb, ns_string, ev);
+    if (nameservice == CORBA_OBJECT_NIL || raised_exception(ev))
+    {
+        ap_log_cerror(APLOG_MARK, APLOG_ERR, 0, ctx->c,
+        "mod_corba: could not obtain reference to "
+        "CORBA nameservice: %s.",
+        (ev->_id) ? ev->_id : "Unknown error");
+        CORBA_exception_free(ev);
+        nameservice = CORBA_OBJECT_NIL;
+        failed = 1;
+    }
+    
+    /* discover objects of claimed contexts */
+    for (i = 0; nameservice != CORBA_OBJECT_NIL && i < contexts->nelts; i++) {
+        listed[i] = list_context_objects(s, pool, nameservice,
+                APR_ARRAY_IDX(contexts, i, const char *));
+        if (listed[i] == NULL)
+            failed++;
+    }
+
+    /* claim discovered objects used by this server */
+    cache_lock();
+    for (i = 0; i < contexts->nelts; i++) {
+        if (listed[i] == NULL)
+            continue;
+        elts    = apr_table_elts(listed[i]);
+        entries = (const apr_table_entry_t *) elts->elts;
+        for (j = 0; j < elts->nelts; j++) {
+            struct resolve_job *job;
+
+            if (!context_object_wanted(sc, entries[j].key) ||
+                !ior_cache_claim(cache->inflight, entries[j].key))
+                continue;
+            job = &APR_ARRAY_PUSH(jobs, struct resolve_job);
+            job->alias = entries[j].key;
+            job->name  = entries[j].val;
+            job->ior   = NULL;
+        }
+    }
+    cache_unlock();
+
+    /* get IOR strings for all claimed objects */
+    ap_log_cerror(APLOG_MARK, APLOG_DEBUG, 0, ctx->c,
+        "ior_cache_fill()->get_iors_from_nameservice");
+
+    rctx.s           = s;
+    rctx.orb         = ctx->orb;
+    rctx.nameservice = nameservice;
+    rctx.njobs       = jobs->nelts;
+    rctx.next        = 0;
+    rctx.jobs        = (struct resolve_job *) jobs->elts;
+    if (nameservice != CORBA_OBJECT_NIL) {
+        resolve_all(&rctx, pool, sc->resolve_threads);
+
+        /* release nameservice */
+        CORBA_Object_release(nameservice, ev);
+        if (raised_exception(ev))
+        {
+            ap_log_cerror(APLOG_MARK, APLOG_ERR, 0, ctx->c,
+            "mod_corba: error when releasing nameservice's "
+            "reference: %s.", ev->_id);
+            CORBA_exception_free(ev);
+        }
+    }
+
+    /* store results in new generation unless cache was flushed meanwhile */
+    cache_lock();
+    if (generation != cache->generation || flushes != cache->flushes) {
+        ap_log_cerror(APLOG_MARK, APLOG_DEBUG, 0, ctx->c,
+            "mod_corba: IOR cache flushed during fill, results dropped");
+        cache->fills_dropped++;
+        gen = NULL;
+    }
+    else if ((gen = ior_gen_copy(cache->current, NULL)) == NULL)
+        failed = 1;
+    for (i = 0; i < contexts->nelts; i++) {
+        const char  *context = APR_ARRAY_IDX(contexts, i, const char *);
+        apr_table_t *bound;
+
+        apr_hash_set(cache->inflight_contexts, context, APR_HASH_KEY_STRING,
+                NULL);
+        if (gen == NULL || listed[i] == NULL)
+            continue;
+        elts    = apr_table_elts(listed[i]);
+        entries = (const apr_table_entry_t *) elts->elts;
+        bound   = apr_table_make(gen->pool, elts->nelts);
+        for (j = 0; j < elts->nelts; j++)
+            apr_table_set(bound, entries[j].key, entries[j].val);
+        apr_hash_set(gen->contexts, apr_pstrdup(gen->pool, context),
+                APR_HASH_KEY_STRING, bound);
+    }
+    for (i = 0; i < jobs->nelts; i++) {
+        apr_hash_set(cache->inflight, rctx.jobs[i].alias, APR_HASH_KEY_STRING,
+                NULL);
+        if (rctx.jobs[i].ior == NULL) {
+            failed++;
+            continue;
+        }
+        if (gen != NULL) {
+            apr_table_set(gen->iors, rctx.jobs[i].alias, rctx.jobs[i].ior);
+            ap_log_cerror(APLOG_MARK, APLOG_DEBUG, 0, ctx->c,
+                "mod_corba: Stored object '%s' IOR string: '%s'",
+                rctx.jobs[i].name, rctx.jobs[i].ior);
+        }
+        CORBA_free(rctx.jobs[i].ior);
+    }
+    if (gen != NULL) {
+        ior_gen_overlay_file(gen);
+        ior_cache_publish(gen);
+    }
+#if APR_HAS_THREADS
+    apr_thread_cond_broadcast(cache->filled);
+#endif
+    apr_pool_destroy(pool);
+
+    ap_log_cerror(APLOG_MARK, APLOG_DEBUG, 0, ctx->c,
+        "return from ior_cache_fill()");
+
+    return (failed == 0);
+}
+
+/**
+ * Function tests whether missing object (or context) is being resolved by
+ * another connection. Object is awaited if it is claimed or if it is known
+ * (from previous listing) to be bound in a context being listed. Cache
+ * mutex must be held by caller.
+ *
+ * @param alias    Alias of missing object or NULL.
+ * @param context  Name of missing context or NULL.
+ * @return         1 if the object (or context) is missing and resolved.
+ */
+#if APR_HAS_THREADS
+static int ior_cache_pending(const char *alias, const char *context)
+{
+    apr_hash_index_t *hi;
+
+    if (alias == NULL)
+        return apr_hash_get(cache->current->contexts, context,
+                            APR_HASH_KEY_STRING) == NULL &&
+               apr_hash_get(cache->inflight_contexts, context,
+                            APR_HASH_KEY_STRING) != NULL;
+
+    if (apr_table_get(cache->current->iors, alias) != NULL)
+        return 0;
+    if (apr_hash_get(cache->inflight, alias, APR_HASH_KEY_STRING) != NULL)
+        return 1;
+    for (hi = apr_hash_first(NULL, cache->inflight_contexts); hi;
+            hi = apr_hash_next(hi)) {
+        const void  *listed;
+        apr_table_t *bound;
+
+        apr_hash_this(hi, &listed, NULL, NULL);
+        bound = apr_hash_get(cache->current->contexts, listed,
+                APR_HASH_KEY_STRING);
+        if (bound != NULL && apr_table_get(bound, alias) != NULL)
+            return 1;
+    }
+    return 0;
+}
+#endif
+
+/**
+ * Function handles miss of IOR cache. If the object (or context) is being
+ * resolved by another connection, the result of that resolution is awaited
+ * and taken instead of repeating it, even if the resolution failed. Cache
+ * is filled by the connection itself only if nothing was awaited, or if
+ * results of awaited fill were dropped because of concurrent flush. The
+ * generation referenced by connection is replaced by the current one.
+ *
+ * @param ctx      Context.
+ * @param alias    Alias of missing object or NULL.
+ * @param context  Name of missing context or NULL.
+ * @return         1 if result of fill of another connection was taken, 0 if
+ *                 the connection filled the cache itself.
+ */
+static int ior_cache_miss(struct get_reference_ctx *ctx, const char *alias,
+        const char *context)
+{
+    int waited = 0;
+
+    cache_lock();
+#if APR_HAS_THREADS
+    {
+        apr_uint32_t dropped = cache->fills_dropped;
+
+        while (ior_cache_pending(alias, context)) {
+            apr_thread_cond_wait(cache->filled, cache->mutex);
+            waited = 1;
+        }
+        if (dropped != cache->fills_dropped)
+            waited = 0;
+    }
+#endif
+    if (!waited &&
+        ((alias != NULL &&
+          apr_table_get(cache->current->iors, alias) == NULL) ||
+         (context != NULL &&
+          apr_hash_get(cache->current->contexts, context,
+                       APR_HASH_KEY_STRING) == NULL)))
+        ior_cache_fill(ctx);
+    ior_gen_unref(ctx->gen);
+    ctx->gen = ior_cache_acquire();
+    cache_unlock();
+    return waited;
+}
+
+/**
+ * Function obtains one reference from IOR string and sticks the
+ * reference to connection.
+ *
+ * @param pctx    Context pointer.
+ * @param alias   Alias of object.
+ * @param name    Name of object.
+ * @return        1 if successfull, 0 in case of failure.
+ */
+static int get_reference_from_ior(void *pctx, const char *alias, __attribute__((unused)) const char *name)
+{
+    void                            *service;
+    CORBA_Environment                ev[1];
+    struct reference_cleanup_arg    *cleanup_arg;
+    const char                      *ior;
+    
+    struct get_reference_ctx *ctx = pctx;
+   
+    CORBA_exception_init(ev);
+
+    /* alias of discovered object lives in generation which may be replaced */
+    alias = apr_pstrdup(ctx->pool, alias);
+
+    /**
+     * Try cache then nameservice (also overwrite cache for futher use)
+     * if nameservice is unavailable retry 3 times then fails.
+     */
+    unsigned n = 3;
+    while (n > 0) {
+        ior = apr_table_get(ctx->gen->iors, alias);
+        if (!ior) {
+            /* result of fill of another connection is not retried */
+            if (ior_cache_miss(ctx, alias, NULL) &&
+                apr_table_get(ctx->gen->iors, alias) == NULL)
+                break;
+        }
+        else {
+            ap_log_cerror(APLOG_MARK, APLOG_DEBUG, 0, ctx->c,
+			"mod_corba: cache hit!");
+            /* try translate IOR string to reference */
+            service = CORBA_ORB_string_to_object(ctx->orb, ior, ev);
+  
+	        if (service == CORBA_OBJECT_NIL || raised_exception(ev)) {
+	        	ap_log_cerror(APLOG_MARK, APLOG_ERR, 0, ctx->c,
+	        		"mod_corba: Could not obtain reference of "
+	        		"object alias '%s' from IOR '%s': %s.", alias, ior,
+	        		(ev->_id) ? ev->_id : "Unknown error");
+	        	CORBA_exception_free(ev);
+	        	return 0;
+	        }
+            break;
+        }
+        --n;
+    }
+    if (!ior) {
+        ap_log_cerror(APLOG_MARK, APLOG_ERR, 0, ctx->c,
+			"mod_corba: Could not obtain reference neither from cache nor "
+            "nameservice.");
+        return 1;
+    }
+    
+	/* register cleanup routine for reference */
+	cleanup_arg = apr_palloc(ctx->pool, sizeof *cleanup_arg);
+	cleanup_arg->c       = ctx->c;
+	cleanup_arg->alias   = alias;
+	cleanup_arg->service = service;
+	apr_pool_cleanup_register(ctx->pool, cleanup_arg, reference_cleanup,
+			apr_pool_cleanup_null);
+	STATS_INC(references);
+	backend_ref(alias);
+
+	/* save object in connection notes */
+	apr_hash_set(ctx->objects, alias, strlen(alias), service);
+
+	ap_log_cerror(APLOG_MARK, APLOG_DEBUG, 0, ctx->c,
+		"mod_corba: reference for alias '%s', belonging to "
+		"connection %ld was obtained from IOR.", alias, ctx->c->id);
+
+	return 1;
+}
+
+
+/**
+ * Function obtains one reference of object discovered in context, if the
+ * object is used by server of connection.
+ *
+ * @param pctx    Context pointer.
+ * @param alias   Alias of object.
+ * @param name    Name of object.
+ * @return        1 if successfull or skipped, 0 in case of failure.
+ */
+static int get_context_reference(void *pctx, const char *alias, const char *name)
+{
+    struct get_reference_ctx *ctx = pctx;
+
+    if (!context_object_wanted(ctx->sc, alias))
+        return 1;
+    if (ctx->gen != NULL)
+        return get_reference_from_ior(pctx, alias, name);
+    return get_reference_from_nameservice(pctx, alias, name);
+}
+
+/**
+ * Function obtains object references for configured objects of server,
+ * from IOR cache if it is enabled, from nameservice otherwise. Everything
+ * (including cleanups of references) is allocated from pool of context.
+ *
+ * @param ctx   Context, connection, orb and pool must be set.
+ * @param sc    Server configuration.
+ */
+static void corba_acquire_references(struct get_reference_ctx *ctx,
+        corba_conf *sc)
+{
+    char    ns_string[150];
+    CORBA_Environment   ev[1];
+    CosNaming_NamingContext nameservice;
+    int     i;
+
+    ctx->objects = apr_hash_make(ctx->pool);
+    ctx->sc      = sc;
+    ctx->gen     = NULL;
+
+    /* if IOR caching is enabled */
+	if (sc->ior_cache_enabled && cache != NULL) {
+        cache_lock();
+        ior_cache_sync(ctx->c);
+        ior_cache_probe_overdue(ctx->c->base_server);
+        ctx->gen = ior_cache_acquire();
+        cache_unlock();
+        apr_table_do(get_reference_from_ior, (void *) ctx, sc->objects, NULL);
+        for (i = 0; i < sc->contexts->nelts; i++) {
+            const char  *context = APR_ARRAY_IDX(sc->contexts, i, const char *);
+            apr_table_t *bound;
+            ior_gen_t   *owner;
+
+            bound = apr_hash_get(ctx->gen->contexts, context, APR_HASH_KEY_STRING);
+            if (bound == NULL) {
+                ior_cache_miss(ctx, NULL, context);
+                bound = apr_hash_get(ctx->gen->contexts, context,
+                        APR_HASH_KEY_STRING);
+            }
+            if (bound == NULL)
+                continue;
+            /* a miss replaces ctx->gen, keep generation of bound alive */
+            owner = ctx->gen;
+            apr_atomic_inc32(&owner->refs);
+            apr_table_do(get_context_reference, (void *) ctx, bound, NULL);
+            ior_gen_unref(owner);
+        }
+        ior_gen_unref(ctx->gen);
+        ctx->gen = NULL;
+        return;
+    }
+
+    /* if IOR cache is NOT enabled handle it in old way (nameservice call) */
+	ns_string[149] = 0;
+	snprintf(ns_string, 149, "corbaloc::%s/NameService", sc->ns_loc);
+	CORBA_exception_init(ev);
+	nameservice = (CosNaming_NamingContext)
+        	CORBA_ORB_string_to_object(ctx->orb, ns_string, ev);
+	
+    if (nameservice == CORBA_OBJECT_NIL || raised_exception(ev))
+	{
+		ap_log_cerror(APLOG_MARK, APLOG_ERR, 0, ctx->c,
+			"mod_corba: could not obtain reference to "
+       		"CORBA nameservice: %s.",
+       		(ev->_id) ? ev->_id : "Unknown error");
+       	CORBA_exception_free(ev);
+       	return;
+	}
+
+    ctx->nameservice = nameservice;	
+	apr_table_do(get_reference_from_nameservice, (void *) ctx, sc->objects, NULL);
+    for (i = 0; i < sc->contexts->nelts; i++) {
+        const char  *context = APR_ARRAY_IDX(sc->contexts, i, const char *);
+        apr_table_t *bound;
+
+        bound = list_context_objects(ctx->c->base_server, ctx->pool,
+                nameservice, context);
+        if (bound != NULL)
+            apr_table_do(get_context_reference, (void *) ctx, bound, NULL);
+    }
+   
+    /* release nameservice */
+    CORBA_Object_release(nameservice, ev);
+    if (raised_exception(ev))
+    {
+        ap_log_cerror(APLOG_MARK, APLOG_ERR, 0, ctx->c,
+        "mod_corba: error when releasing nameservice's "
+    	"reference: %s.", ev->_id);
+        CORBA_exception_free(ev);
+    }
+}
+
+#if APR_HAS_THREADS
+/** Key of early acquisition in user data of connection pool. */
+#define EARLY_ACQUIRE_KEY       "mod_corba_early_acquire"
+
+/**
+ * Acquisition of references started in pre_connection hook, which runs
+ * in its own thread while the connection is set up (TLS handshake).
+ */
+struct early_acquire {
+    struct get_reference_ctx ctx;   /**< Context of acquisition. */
+    corba_conf     *sc;             /**< Server configuration. */
+    apr_thread_t   *thread;         /**< Thread acquiring references. */
+    apr_time_t      start;          /**< Start of acquisition. */
+    int             collected;      /**< Thread was joined. */
+};
+
+/**
+ * Thread acquiring references of connection. The thread uses only its own
+ * pool, connection pool may be used by connection's thread meanwhile.
+ *
+ * @param thd   Thread.
+ * @param data  Early acquisition.
+ * @return      NULL.
+ */
+static void * APR_THREAD_FUNC early_acquire_thread(apr_thread_t *thd, void *data)
+{
+    struct early_acquire *early = data;
+
+    corba_acquire_references(&early->ctx, early->sc);
+    if (shared != NULL)
+        stats_latency(shared->stats.acquire_hist,
+                &shared->stats.acquire_max, apr_time_now() - early->start);
+    apr_thread_exit(thd, APR_SUCCESS);
+    return NULL;
+}
+
+/**
+ * Function waits for early acquisition of references and binds acquired
+ * references to connection.
+ *
+ * @param early  Early acquisition.
+ * @return       Hash table of object references.
+ */
+static apr_hash_t *early_acquire_collect(struct early_acquire *early)
+{
+    apr_status_t rv;
+
+    if (!early->collected) {
+        apr_thread_join(&rv, early->thread);
+        early->collected = 1;
+        ap_set_module_config(early->ctx.c->conn_config, &corba_module,
+                early->ctx.objects);
+    }
+    return early->ctx.objects;
+}
+
+/**
+ * Cleanup waiting for early acquisition before the connection pool is
+ * destroyed. Pool of acquisition is destroyed afterwards, which releases
+ * acquired references.
+ *
+ * @param data  Early acquisition.
+ * @return      Always success.
+ */
+static apr_status_t early_acquire_cleanup(void *data)
+{
+    struct early_acquire *early = data;
+
+    early_acquire_collect(early);
+    apr_pool_destroy(early->ctx.pool);
+    return APR_SUCCESS;
+}
+#endif
+
+/**
+ * Pre-connection hook.
+ *
+ * If CorbaEarlyAcquire is enabled, acquisition of object references is
+ * started in a separate thread, so that it runs in parallel with TLS
+ * handshake. References are collected by corba_connection_objects().
+ *
+ * @param c    Incoming connection.
+ * @param csd  Socket of connection.
+ * @return     Return code
+ */
+static int corba_pre_connection(conn_rec *c, __attribute__((unused)) void *csd)
+{
+#if APR_HAS_THREADS
+    struct early_acquire *early;
+    apr_pool_t  *pool;
+
+    corba_conf  *sc = (corba_conf *)
+        ap_get_module_config(c->base_server->module_config, &corba_module);
+
+    if (!sc->enabled || !sc->early_acquire || orb == NULL)
+        return OK;
+    /* allocator of connection pool is not thread-safe, use own one */
+    if (apr_pool_create_unmanaged_ex(&pool, NULL, NULL) != APR_SUCCESS)
+        return OK;
+
+    early = apr_pcalloc(c->pool, sizeof *early);
+    early->ctx.c    = c;
+    early->ctx.orb  = orb;
+    early->ctx.pool = pool;
+    early->sc       = sc;
+    early->start    = apr_time_now();
+    if (apr_thread_create(&early->thread, NULL, early_acquire_thread, early,
+            pool) != APR_SUCCESS) {
+        ap_log_cerror(APLOG_MARK, APLOG_ERR, 0, c,
+            "mod_corba: could not start early acquisition of references.");
+        apr_pool_destroy(pool);
+        return OK;
+    }
+    STATS_INC(connections);
+    apr_pool_pre_cleanup_register(c->pool, early, early_acquire_cleanup);
+    apr_pool_userdata_setn(early, EARLY_ACQUIRE_KEY, NULL, c->pool);
+#else
+    (void) c;
+#endif
+    return OK;
+}
+
+/**
+ * Function returns object references of connection. If their acquisition
+ * was started in pre_connection hook, the function waits for it to finish.
+ * The function is exported for modules which use the references.
+ *
+ * @param c   Connection.
+ * @return    Hash table alias - object reference, NULL if there is none.
+ */
+static apr_hash_t *corba_connection_objects(conn_rec *c)
+{
+#if APR_HAS_THREADS
+    void    *early = NULL;
+
+    apr_pool_userdata_get(&early, EARLY_ACQUIRE_KEY, c->pool);
+    if (early != NULL)
+        return early_acquire_collect(early);
+#endif
+    return ap_get_module_config(c->conn_config, &corba_module);
+}
+
+/**
+ * Connection handler.
+ *
+ * Connection handler obtains object references from IOR string for
+ * configured objects. These object references are sticked to connection
+ * for later use by other modules. Cleanup routine which handles
+ * reference's release is bound to connection. If acquisition was started
+ * in pre_connection hook, it is left to corba_connection_objects().
+ *
+ * @param c   Incoming connection.
+ * @return    Return code
+ */
+static int corba_process_connection(conn_rec *c)
+{
+    apr_time_t  start;
+#if APR_HAS_THREADS
+    void       *early = NULL;
+#endif
+    
+	struct get_reference_ctx	ctx;
+	
+    server_rec  *s = c->base_server;
+	corba_conf  *sc = (corba_conf *)
+		ap_get_module_config(s->module_config, &corba_module);
+
+    ap_log_cerror(APLOG_MARK, APLOG_DEBUG, 0, c,
+        "call corba_process_connection()");
+
+	/* do nothing if corba is disabled */
+	if (!sc->enabled)
+		return DECLINED;
+
+#if APR_HAS_THREADS
+    /* references are being acquired since pre_connection */
+    apr_pool_userdata_get(&early, EARLY_ACQUIRE_KEY, c->pool);
+    if (early != NULL)
+        return DECLINED;
+#endif
+
+	if (orb == NULL) {
+		ap_log_cerror(APLOG_MARK, APLOG_ERR, 0, c,
+			"mod_corba: ORB of child is not initialized.");
+		return DECLINED;
+	}
+
+    start = apr_time_now();
+    STATS_INC(connections);
+
+    /* init ctx structure and obtain references for all configured objects */
+    ctx.c       = c;
+    ctx.orb     = orb;
+    ctx.pool    = c->pool;
+    corba_acquire_references(&ctx, sc);
+
+	/* bind hash table of object references to conn_rec */
+	ap_set_module_config(c->conn_config, &corba_module, ctx.objects);
+	if (shared != NULL)
+		stats_latency(shared->stats.acquire_hist,
+				&shared->stats.acquire_max, apr_time_now() - start);
+
+	return DECLINED;
+}
+
+/**
+ * Function requests flush of objects (or discovered contexts) given by
+ * comma separated list of aliases from IOR cache of all children.
+ *
+ * @param r        Request.
+ * @param aliases  Comma separated list of aliases.
+ */
+static void corba_flush_aliases(request_rec *r, const char *aliases)
+{
+    char    *list = apr_pstrdup(r->pool, aliases);
+    char    *last;
+    char    *alias;
+
+    for (alias = apr_strtok(list, ",", &last); alias != NULL;
+            alias = apr_strtok(NULL, ",", &last)) {
+        apr_atomic_inc32(&shared->alias_generation[flush_slot(alias)]);
+        ap_log_rerror(APLOG_MARK, APLOG_NOTICE, 0, r,
+            "mod_corba: flush of alias '%s' requested", alias);
+    }
+    apr_atomic_inc32(&shared->flushes);
+}
+
+/**
+ * Function zeroes counters of module activity except of gauge of references
+ * held by connections.
+ */
+static void corba_stats_reset(void)
+{
+    corba_stats_t  *stats = &shared->stats;
+    int             i, n;
+
+    apr_atomic_set32(&stats->connections, 0);
+    apr_atomic_set32(&stats->fills, 0);
+    apr_atomic_set32(&stats->resolves, 0);
+    apr_atomic_set32(&stats->resolve_errors, 0);
+    apr_atomic_set32(&stats->acquire_max, 0);
+    apr_atomic_set32(&stats->lock_wait_max, 0);
+    for (i = 0; i < STATS_BUCKETS; i++) {
+        apr_atomic_set32(&stats->acquire_hist[i], 0);
+        apr_atomic_set32(&stats->lock_wait_hist[i], 0);
+    }
+    for (n = 0; n < LIMIT_SLOTS; n++)
+        apr_atomic_set32(&shared->limits[n].rejected, 0);
+    for (n = 0; n < CALL_SLOTS; n++) {
+        call_stats_t *slot = &shared->calls[n];
+
+        apr_atomic_set32(&slot->calls, 0);
+        apr_atomic_set32(&slot->exceptions, 0);
+        apr_atomic_set32(&slot->max, 0);
+        for (i = 0; i < STATS_BUCKETS; i++)
+            apr_atomic_set32(&slot->hist[i], 0);
+    }
+}
+
+/**
+ * Function returns upper bound of given percentile of latency histogram.
+ *
+ * @param hist     Histogram with STATS_BUCKETS buckets.
+ * @param percent  Percentile.
+ * @return         Upper bound in microseconds, 0 if histogram is empty.
+ */
+static apr_uint32_t stats_percentile(volatile apr_uint32_t *hist,
+        unsigned percent)
+{
+    apr_uint64_t    total = 0;
+    apr_uint64_t    sum = 0;
+    int             i;
+
+    for (i = 0; i < STATS_BUCKETS; i++)
+        total += apr_atomic_read32(&hist[i]);
+    if (total == 0)
+        return 0;
+    for (i = 0; i < STATS_BUCKETS; i++) {
+        sum += apr_atomic_read32(&hist[i]);
+        if (sum * 100 >= total * percent)
+            break;
+    }
+    return (i >= STATS_BUCKETS - 1) ? 0xffffffff : (2u << i);
+}
+
+/**
+ * Function prints counters of module activity.
+ *
+ * @param r   Request.
+ */
+static void corba_stats_print(request_rec *r)
+{
+    corba_stats_t *stats = &shared->stats;
+    int            i;
+
+    ap_rprintf(r, "connections: %u\n", apr_atomic_read32(&stats->connections));
+    ap_rprintf(r, "cache fills: %u\n", apr_atomic_read32(&stats->fills));
+    ap_rprintf(r, "resolves: %u\n", apr_atomic_read32(&stats->resolves));
+    ap_rprintf(r, "resolve errors: %u\n",
+            apr_atomic_read32(&stats->resolve_errors));
+    ap_rprintf(r, "references held: %u\n",
+            apr_atomic_read32(&stats->references));
+    ap_rprintf(r, "acquire p50: %u us\n",
+            stats_percentile(stats->acquire_hist, 50));
+    ap_rprintf(r, "acquire p99: %u us\n",
+            stats_percentile(stats->acquire_hist, 99));
+    ap_rprintf(r, "acquire max: %u us\n",
+            apr_atomic_read32(&stats->acquire_max));
+    ap_rprintf(r, "lock wait p99: %u us\n",
+            stats_percentile(stats->lock_wait_hist, 99));
+    ap_rprintf(r, "lock wait max: %u us\n",
+            apr_atomic_read32(&stats->lock_wait_max));
+
+    for (i = 0; i < CALL_SLOTS; i++) {
+        call_stats_t *slot = &shared->calls[i];
+
+        if (apr_atomic_read32(&slot->state) != 2)
+            continue;
+        ap_rprintf(r, "call %s.%s: %u calls, %u exceptions, p50 %u us, "
+                "p99 %u us, max %u us\n", slot->alias, slot->operation,
+                apr_atomic_read32(&slot->calls),
+                apr_atomic_read32(&slot->exceptions),
+                stats_percentile(slot->hist, 50),
+                stats_percentile(slot->hist, 99),
+                apr_atomic_read32(&slot->max));
+    }
+    for (i = 0; i < LIMIT_SLOTS; i++) {
+        limit_t *lim = &shared->limits[i];
+
+        if (lim->alias[0] == '\0')
+            continue;
+        ap_rprintf(r, "limit %s: %u/%u active, %u/%u waiting, %u rejected, "
+                "%u/%u sockets\n",
+                lim->alias, apr_atomic_read32(&lim->active), lim->limit,
+                apr_atomic_read32(&lim->waiting), lim->queue,
+                apr_atomic_read32(&lim->rejected),
+                apr_atomic_read32(&lim->sockets), lim->sockets_max);
+    }
+}
+
+/**
+ * Function decides whether client of request may use corba-admin handler.
+ * Only clients from networks given by CorbaAdminAllow are allowed, if the
+ * directive is not used only local clients are allowed.
+ *
+ * @param r   Request.
+ * @param sc  Server configuration.
+ * @return    1 if client is allowed, 0 otherwise.
+ */
+static int corba_admin_allowed(request_rec *r, const corba_conf *sc)
+{
+    static const char * const local[] = { "127.0.0.0/8", "::1" };
+    apr_sockaddr_t     *addr;
+    apr_ipsubnet_t     *ipsub;
+    int                 i;
+
+#if AP_MODULE_MAGIC_AT_LEAST(20111130, 0)
+    addr = r->useragent_addr;
+#else
+    addr = r->connection->remote_addr;
+#endif
+    if (addr == NULL)
+        return 0;
+    if (sc->admin_allow != NULL) {
+        for (i = 0; i < sc->admin_allow->nelts; i++) {
+            if (apr_ipsubnet_test(APR_ARRAY_IDX(sc->admin_allow, i,
+                            apr_ipsubnet_t *), addr))
+                return 1;
+        }
+        return 0;
+    }
+    for (i = 0; i < (int) (sizeof local / sizeof local[0]); i++) {
+        if (apr_ipsubnet_create(&ipsub, local[i], NULL, r->pool) ==
+                APR_SUCCESS && apr_ipsubnet_test(ipsub, addr))
+            return 1;
+    }
+    return 0;
+}
+
+/**
+ * Handler of "corba-admin" requests.
+ *
+ * GET request prints state of IOR cache and counters of module activity.
+ * POST request with query string "flush" flushes IOR cache of all children,
+ * "flush=alias1,alias2" flushes only given aliases. Children rebuild their
+ * cache on next access. "reset" zeroes counters. Clients not allowed by
+ * CorbaAdminAllow are refused, access may be further restricted in
+ * configuration of handler's location.
+ *
+ * @param r   Request.
+ * @return    Status.
+ */
+static int corba_admin_handler(request_rec *r)
+{
+    int cached = -1;
+    corba_conf *sc;
+
+    if (r->handler == NULL || strcmp(r->handler, "corba-admin") != 0)
+        return DECLINED;
+
+    sc = (corba_conf *) ap_get_module_config(r->server->module_config,
+            &corba_module);
+    if (!corba_admin_allowed(r, sc)) {
+        ap_log_rerror(APLOG_MARK, APLOG_ERR, 0, r,
+            "mod_corba: client denied access to corba-admin "
+            "(see CorbaAdminAllow)");
+        return HTTP_FORBIDDEN;
+    }
+
+    r->allowed |= (AP_METHOD_BIT << M_GET) | (AP_METHOD_BIT << M_POST);
+    if (r->method_number != M_GET && r->method_number != M_POST)
+        return HTTP_METHOD_NOT_ALLOWED;
+
+    if (shared == NULL) {
+        ap_log_rerror(APLOG_MARK, APLOG_ERR, 0, r,
+            "mod_corba: shared memory is not available.");
+        return HTTP_INTERNAL_SERVER_ERROR;
+    }
+
+    if (r->method_number == M_POST) {
+        ap_discard_request_body(r);
+        if (r->args == NULL || strcmp(r->args, "flush") == 0) {
+            apr_atomic_inc32(&shared->generation);
+            ap_log_rerror(APLOG_MARK, APLOG_NOTICE, 0, r,
+                "mod_corba: flush of IOR cache requested");
+        }
+        else if (strncmp(r->args, "flush=", 6) == 0 && r->args[6] != '\0') {
+            corba_flush_aliases(r, r->args + 6);
+        }
+        else if (strcmp(r->args, "reset") == 0) {
+            corba_stats_reset();
+            ap_log_rerror(APLOG_MARK, APLOG_NOTICE, 0, r,
+                "mod_corba: counters reset");
+        }
+        else {
+            return HTTP_BAD_REQUEST;
+        }
+    }
+
+    if (cache != NULL) {
+        cache_lock();
+        cached = apr_table_elts(cache->current->iors)->nelts;
+        cache_unlock();
+    }
+
+    ap_set_content_type(r, "text/plain");
+    if (r->header_only)
+        return OK;
+
+    ap_rprintf(r, "generation: %u\n", apr_atomic_read32(&shared->generation));
+    ap_rprintf(r, "alias flushes: %u\n", apr_atomic_read32(&shared->flushes));
+    ap_rprintf(r, "child cached objects: %d\n", cached);
+    corba_stats_print(r);
+
+    if (cache != NULL) {
+        apr_hash_index_t *hi;
+
+        cache_lock();
+        for (hi = apr_hash_first(r->pool, cache->health); hi;
+                hi = apr_hash_next(hi)) {
+            const void *alias;
+            void       *val;
+            health_t   *health;
+
+            apr_hash_this(hi, &alias, NULL, &val);
+            health = val;
+            ap_rprintf(r, "child health %s: %s (%" APR_TIME_T_FMT " us, "
+                    "%" APR_TIME_T_FMT " s ago)\n", (const char *) alias,
+                    health->alive ? "alive" : "dead", health->latency,
+                    apr_time_sec(apr_time_now() - health->checked));
+        }
+        ap_rprintf(r, "child GIOP sockets: %d\n", cache->sockets);
+        for (hi = apr_hash_first(r->pool, cache->backends); hi;
+                hi = apr_hash_next(hi)) {
+            void       *val;
+            backend_t  *b;
+
+            apr_hash_this(hi, NULL, NULL, &val);
+            b = val;
+            if (!b->connected)
+                continue;
+            ap_rprintf(r, "child socket %s: %u references, idle %"
+                    APR_TIME_T_FMT " s\n", b->alias, b->refs,
+                    apr_time_sec(apr_time_now() - b->last_used));
+        }
+        cache_unlock();
+    }
+
+    return OK;
+}
+
+/**
+ * Function records health of object. Cache mutex must be held by caller.
+ *
+ * @param alias    Alias of object.
+ * @param alive    1 if object is alive, 0 if dead.
+ * @param latency  Duration of probe.
+ */
+static void ior_cache_set_health(const char *alias, int alive,
+        apr_interval_time_t latency)
+{
+    health_t *health = apr_hash_get(cache->health, alias, APR_HASH_KEY_STRING);
+
+    if (health == NULL) {
+        health = apr_pcalloc(cache->health_pool, sizeof *health);
+        apr_hash_set(cache->health, apr_pstrdup(cache->health_pool, alias),
+                APR_HASH_KEY_STRING, health);
+    }
+    health->alive   = alive;
+    health->checked = apr_time_now();
+    health->latency = latency;
+}
+
+/**
+ * Function fails probe in progress which exceeded CorbaProbeTimeout. The
+ * probe cannot be interrupted, so the object is reported dead and its IOR
+ * string is evicted from cache (unless it was replaced meanwhile) before
+ * the probe returns. Cache mutex must be held by caller.
+ *
+ * @param s   Server record (used for logging, may be NULL).
+ */
+static void ior_cache_probe_overdue(server_rec *s)
+{
+    apr_interval_time_t  elapsed;
+    const char          *ior;
+    ior_gen_t           *gen;
+
+    if (cache->probe_alias == NULL || cache->probe_failed)
+        return;
+    elapsed = apr_time_now() - cache->probe_started;
+    if (elapsed <= cache->probe_timeout)
+        return;
+    cache->probe_failed = 1;
+    ior_cache_set_health(cache->probe_alias, 0, elapsed);
+    ior = apr_table_get(cache->current->iors, cache->probe_alias);
+    if (ior == NULL || strcmp(ior, cache->probe_ior) != 0 ||
+        (gen = ior_gen_copy(cache->current, NULL)) == NULL)
+        return;
+    apr_table_unset(gen->iors, cache->probe_alias);
+    ior_cache_publish(gen);
+    ap_log_error(APLOG_MARK, APLOG_NOTICE, 0, s,
+        "mod_corba: alias '%s' with hung probe evicted from IOR cache",
+        cache->probe_alias);
+}
+
+/**
+ * Exported function returning health of object (see mod_corba.h).
+ *
+ * @param alias   Alias of object.
+ * @return        1 if object is alive, 0 if it is dead, -1 if it was not
+ *                probed yet.
+ */
+static int corba_object_alive(const char *alias)
+{
+    health_t   *health;
+    int         alive = -1;
+
+    if (cache == NULL)
+        return -1;
+    cache_lock();
+    ior_cache_probe_overdue(NULL);
+    health = apr_hash_get(cache->health, alias, APR_HASH_KEY_STRING);
+    if (health != NULL)
+        alive = health->alive;
+    cache_unlock();
+    return alive;
+}
+
+#if APR_HAS_THREADS
+/** Granularity of prober's sleep, limits delay of child exit. */
+#define PROBE_SLEEP_STEP        apr_time_from_msec(100)
+
+/** Interval in which idle GIOP connections are looked for. */
+#define REAP_INTERVAL           apr_time_from_sec(1)
+
+/**
+ * State of background liveness prober of child.
+ */
+typedef struct {
+    server_rec             *s;          /**< Main server (used for logging). */
+    apr_interval_time_t     interval;   /**< Time between probes. */
+    apr_interval_time_t     timeout;    /**< Probe slower than this fails. */
+    volatile apr_uint32_t   stop;       /**< Set on child exit. */
+    apr_thread_t           *thread;     /**< Prober thread. */
+} prober_t;
+
+/**
+ * One cached object probed by prober.
+ */
+struct probe_item {
+    const char             *alias;      /**< Alias of object. */
+    const char             *ior;        /**< Cached IOR string. */
+    int                     alive;      /**< Result of probe. */
+    apr_interval_time_t     latency;    /**< Duration of probe. */
+};
+
+/**
+ * Function checks whether object referenced by IOR string is alive by
+ * calling _non_existent on it.
+ *
+ * ORBit2 has only a process-wide GIOP timeout (disabled by the module),
+ * so a probe cannot be interrupted; probe which takes longer than
+ * CorbaProbeTimeout is considered failed. A hung backend thus blocks the
+ * prober thread, never a connection; the object is failed meanwhile by
+ * ior_cache_probe_overdue().
+ *
+ * @param prober   Prober.
+ * @param item     Probed object.
+ */
+static void probe_object(prober_t *prober, struct probe_item *item)
+{
+    CORBA_Environment   ev[1];
+    ORBitConnection    *call;
+    CORBA_Object        object;
+    CORBA_boolean       gone;
+    apr_time_t          start = apr_time_now();
+
+    item->alive   = 0;
+    item->latency = 0;
+
+    CORBA_exception_init(ev);
+    object = CORBA_ORB_string_to_object(orb, item->ior, ev);
+    if (object == CORBA_OBJECT_NIL || raised_exception(ev)) {
+        ap_log_error(APLOG_MARK, APLOG_WARNING, 0, prober->s,
+            "mod_corba: probe of alias '%s' failed, invalid IOR: %s.",
+            item->alias, (ev->_id) ? ev->_id : "Unknown error");
+        CORBA_exception_free(ev);
+        return;
+    }
+
+    call = backend_other_begin(object);
+    gone = CORBA_Object_non_existent(object, ev);
+    backend_other_end(call);
+    item->latency = apr_time_now() - start;
+    corba_call_record(item->alias, "_non_existent", item->latency,
+            raised_exception(ev));
+    if (raised_exception(ev)) {
+        ap_log_error(APLOG_MARK, APLOG_WARNING, 0, prober->s,
+            "mod_corba: probe of alias '%s' failed: %s.", item->alias,
+            (ev->_id) ? ev->_id : "Unknown error");
+        CORBA_exception_free(ev);
+        gone = CORBA_TRUE;
+    }
+    else if (gone) {
+        ap_log_error(APLOG_MARK, APLOG_WARNING, 0, prober->s,
+            "mod_corba: probe of alias '%s' failed, object does not exist.",
+            item->alias);
+    }
+    else if (item->latency > prober->timeout) {
+        ap_log_error(APLOG_MARK, APLOG_WARNING, 0, prober->s,
+            "mod_corba: probe of alias '%s' failed, it took %" APR_TIME_T_FMT
+            " ms.", item->alias, apr_time_msec(item->latency));
+        gone = CORBA_TRUE;
+    }
+    CORBA_Object_release(object, ev);
+    CORBA_exception_free(ev);
+
+    item->alive = !gone;
+}
+
+/**
+ * Function probes all objects in IOR cache. Objects of current generation
+ * are probed without holding cache mutex. IOR strings of dead objects are
+ * evicted from cache (unless they were replaced meanwhile), so they are
+ * resolved again on next access. Probe in progress is published in cache,
+ * so that a hung probe is failed by ior_cache_probe_overdue().
+ *
+ * @param prober   Prober.
+ * @param pool     Pool used for temporary allocations.
+ */
+static void ior_cache_probe(prober_t *prober, apr_pool_t *pool)
+{
+    const apr_array_header_t *elts;
+    const apr_table_entry_t  *entries;
+    struct probe_item        *items;
+    ior_gen_t                *gen;
+    ior_gen_t                *evicted = NULL;
+    int                       nitems;
+    int                       i;
+
+    cache_lock();
+    gen = ior_cache_acquire();
+    cache_unlock();
+
+    /* strings stay valid while the generation is referenced */
+    elts    = apr_table_elts(gen->iors);
+    entries = (const apr_table_entry_t *) elts->elts;
+    nitems  = elts->nelts;
+    items   = apr_pcalloc(pool, nitems * sizeof *items);
+    for (i = 0; i < nitems && !apr_atomic_read32(&prober->stop); i++) {
+        items[i].alias = entries[i].key;
+        items[i].ior   = entries[i].val;
+        cache_lock();
+        cache->probe_alias   = items[i].alias;
+        cache->probe_ior     = items[i].ior;
+        cache->probe_started = apr_time_now();
+        cache->probe_failed  = 0;
+        cache_unlock();
+        probe_object(prober, &items[i]);
+        cache_lock();
+        cache->probe_alias = NULL;
+        cache_unlock();
+    }
+    nitems = i;
+
+    cache_lock();
+    for (i = 0; i < nitems; i++) {
+        const char *ior;
+
+        ior_cache_set_health(items[i].alias, items[i].alive, items[i].latency);
+        if (items[i].alive)
+            continue;
+        ior = apr_table_get(cache->current->iors, items[i].alias);
+        if (ior == NULL || strcmp(ior, items[i].ior) != 0)
+            continue;
+        if (evicted == NULL &&
+            (evicted = ior_gen_copy(cache->current, NULL)) == NULL)
+            break;
+        apr_table_unset(evicted->iors, items[i].alias);
+        ap_log_error(APLOG_MARK, APLOG_NOTICE, 0, prober->s,
+            "mod_corba: dead alias '%s' evicted from IOR cache",
+            items[i].alias);
+    }
+    if (evicted != NULL)
+        ior_cache_publish(evicted);
+    cache_unlock();
+
+    ior_gen_unref(gen);
+}
+
+/**
+ * Thread function of background liveness prober.
+ */
+static void * APR_THREAD_FUNC prober_thread(apr_thread_t *thd, void *data)
+{
+    prober_t   *prober = data;
+    apr_pool_t *pool;
+    apr_time_t  next = apr_time_now() + prober->interval;
+
+    if (apr_pool_create(&pool, NULL) != APR_SUCCESS) {
+        apr_thread_exit(thd, APR_EGENERAL);
+        return NULL;
+    }
+    while (!apr_atomic_read32(&prober->stop)) {
+        if (apr_time_now() < next) {
+            apr_sleep(PROBE_SLEEP_STEP);
+            continue;
+        }
+        ior_cache_probe(prober, pool);
+        apr_pool_clear(pool);
+        next = apr_time_now() + prober->interval;
+    }
+    apr_pool_destroy(pool);
+    apr_thread_exit(thd, APR_SUCCESS);
+    return NULL;
+}
+
+/**
+ * Cleanup routine stops prober thread. It is registered as pre-cleanup of
+ * child pool, so it runs before the pool of thread (a subpool) and the ORB
+ * are destroyed.
+ *
+ * @param data   Prober.
+ */
+static apr_status_t prober_cleanup(void *data)
+{
+    prober_t       *prober = data;
+    apr_status_t    rv;
+
+    apr_atomic_set32(&prober->stop, 1);
+    apr_thread_join(&rv, prober->thread);
+    return APR_SUCCESS;
+}
+
+/**
+ * Function starts background liveness prober of child.
+ *
+ * @param p     Child pool.
+ * @param s     Main server record.
+ * @param sc    Configuration of main server.
+ */
+static void corba_prober_start(apr_pool_t *p, server_rec *s, corba_conf *sc)
+{
+    prober_t       *prober = apr_pcalloc(p, sizeof *prober);
+    apr_status_t    rv;
+
+    prober->s        = s;
+    prober->interval = apr_time_from_sec(sc->probe_interval);
+    prober->timeout  = apr_time_from_msec(sc->probe_timeout);
+    prober->stop     = 0;
+    cache->probe_timeout = prober->timeout;
+
+    rv = apr_thread_create(&prober->thread, NULL, prober_thread, prober, p);
+    if (rv != APR_SUCCESS) {
+        ap_log_error(APLOG_MARK, APLOG_ERR, rv, s,
+            "mod_corba: could not start liveness prober.");
+        return;
+    }
+    apr_pool_pre_cleanup_register(p, prober, prober_cleanup);
+}
+#endif
+
+#if APR_HAS_THREADS
+/**
+ * State of reaper of idle GIOP connections of child.
+ */
+typedef struct {
+    server_rec             *s;          /**< Main server (used for logging). */
+    apr_interval_time_t     timeout;    /**< Connection idle longer is closed. */
+    volatile apr_uint32_t   stop;       /**< Set on child exit. */
+    apr_thread_t           *thread;     /**< Reaper thread. */
+} reaper_t;
+
+/**
+ * Function finds out whether GIOP connection of object may be closed. All
+ * objects sharing the connection must be idle and without calls in flight,
+ * and no call of nameservice or probe may be in flight on it. Cache mutex
+ * must be held by caller.
+ *
+ * @param reaper   Reaper.
+ * @param b        Connected object with known connection.
+ * @param now      Current time.
+ * @return         1 if the connection is idle, 0 otherwise.
+ */
+static int backend_endpoint_idle(reaper_t *reaper, const backend_t *b,
+        apr_time_t now)
+{
+    ORBitConnection **calls = (ORBitConnection **) cache->other_calls->elts;
+    apr_hash_index_t *hi;
+    int               i;
+
+    for (i = 0; i < cache->other_calls->nelts; i++) {
+        if (calls[i] == b->cnx)
+            return 0;
+    }
+    for (hi = apr_hash_first(NULL, cache->backends); hi;
+            hi = apr_hash_next(hi)) {
+        void            *val;
+        const backend_t *other;
+
+        apr_hash_this(hi, NULL, NULL, &val);
+        other = val;
+        if (!other->connected)
+            continue;
+        /* call of object whose connection is not known yet */
+        if (other->cnx == NULL && other->inflight > 0)
+            return 0;
+        if (other->cnx == b->cnx &&
+            (other->inflight > 0 || now - other->last_used < reaper->timeout))
+            return 0;
+    }
+    return 1;
+}
+
+/**
+ * Function closes GIOP connections of objects which were not called for
+ * CorbaGIOPIdleTimeout. References of objects stay valid, ORBit opens the
+ * connection again on next call. The connection is closed with cache mutex
+ * held, so that no call can be admitted by corba_call_begin() meanwhile;
+ * it is closed through the reference held by objects, which neither opens
+ * the connection nor waits for it.
+ *
+ * @param reaper   Reaper.
+ * @param pool     Pool for temporary allocations.
+ */
+static void reap_idle_connections(reaper_t *reaper, apr_pool_t *pool)
+{
+    apr_array_header_t *closed = apr_array_make(pool, 4,
+            sizeof(ORBitConnection *));
+    apr_hash_index_t   *hi;
+    apr_time_t          now = apr_time_now();
+    int                 i;
+
+    cache_lock();
+    for (hi = apr_hash_first(pool, cache->backends); hi;
+            hi = apr_hash_next(hi)) {
+        void                *val;
+        backend_t           *b;
+        apr_hash_index_t    *hj;
+        ORBitConnection     *cnx;
+
+        apr_hash_this(hi, NULL, NULL, &val);
+        b = val;
+        if (!b->connected || b->cnx == NULL ||
+            !backend_endpoint_idle(reaper, b, now))
+            continue;
+        cnx = b->cnx;
+        if (link_connection_get_status((LinkConnection *) cnx) ==
+                LINK_CONNECTED)
+            link_connection_disconnect((LinkConnection *) cnx);
+
+        /* all objects of the endpoint lost their connection */
+        for (hj = apr_hash_first(pool, cache->backends); hj;
+                hj = apr_hash_next(hj)) {
+            backend_t *other;
+
+            apr_hash_this(hj, NULL, NULL, &val);
+            other = val;
+            if (other->connected && other->cnx == cnx) {
+                ap_log_error(APLOG_MARK, APLOG_DEBUG, 0, reaper->s,
+                    "mod_corba: closing idle GIOP connection of alias "
+                    "'%s'.", other->alias);
+                APR_ARRAY_PUSH(closed, ORBitConnection *) =
+                    backend_closed(other);
+            }
+        }
+    }
+    cache_unlock();
+
+    for (i = 0; i < closed->nelts; i++)
+        ORBit_small_connection_unref(APR_ARRAY_IDX(closed, i,
+                    ORBitConnection *));
+}
+
+/**
+ * Thread of reaper of idle GIOP connections.
+ *
+ * @param thd   Thread.
+ * @param data  Reaper.
+ * @return      NULL.
+ */
+static void * APR_THREAD_FUNC reaper_thread(apr_thread_t *thd, void *data)
+{
+    reaper_t   *reaper = data;
+    apr_pool_t *pool;
+    apr_time_t  next = apr_time_now() + REAP_INTERVAL;
+
+    if (apr_pool_create(&pool, NULL) != APR_SUCCESS) {
+        apr_thread_exit(thd, APR_EGENERAL);
+        return NULL;
+    }
+    while (!apr_atomic_read32(&reaper->stop)) {
+        if (apr_time_now() < next) {
+            apr_sleep(PROBE_SLEEP_STEP);
+            continue;
+        }
+        reap_idle_connections(reaper, pool);
+        apr_pool_clear(pool);
+        next = apr_time_now() + REAP_INTERVAL;
+    }
+    apr_pool_destroy(pool);
+    apr_thread_exit(thd, APR_SUCCESS);
+    return NULL;
+}
+
+/**
+ * Cleanup routine stops reaper thread. It is registered as pre-cleanup, so
+ * it runs before the ORB and the cache are destroyed by cleanups of child
+ * pool.
+ *
+ * @param data   Reaper.
+ */
+static apr_status_t reaper_cleanup(void *data)
+{
+    reaper_t       *reaper = data;
+    apr_status_t    rv;
+
+    apr_atomic_set32(&reaper->stop, 1);
+    apr_thread_join(&rv, reaper->thread);
+    return APR_SUCCESS;
+}
+
+/**
+ * Function starts reaper of idle GIOP connections of child.
+ *
+ * @param p     Child pool.
+ * @param s     Main server record.
+ * @param sc    Configuration of main server.
+ */
+static void corba_reaper_start(apr_pool_t *p, server_rec *s, corba_conf *sc)
+{
+    reaper_t       *reaper = apr_pcalloc(p, sizeof *reaper);
+    apr_status_t    rv;
+
+    reaper->s       = s;
+    reaper->timeout = apr_time_from_sec(sc->idle_timeout);
+    reaper->stop    = 0;
+
+    rv = apr_thread_create(&reaper->thread, NULL, reaper_thread, reaper, p);
+    if (rv != APR_SUCCESS) {
+        ap_log_error(APLOG_MARK, APLOG_ERR, rv, s,
+            "mod_corba: could not start reaper of idle connections.");
+        return;
+    }
+    apr_pool_pre_cleanup_register(p, reaper, reaper_cleanup);
+}
+#endif
+
+/**
+ * Function reads mappings of aliases from file given by CorbaIORFile, or
+ * from all regular files of directory. Each line contains alias and either
+ * IOR string (IOR:..., corbaloc:...) or name of object (CONTEXTNAME.NAME)
+ * separated by white space. Empty lines and lines starting by '#' are
+ * ignored. A missing file is an empty mapping, so that deleting the file
+ * returns all its aliases to nameservice.
+ *
+ * @param s      Server record (used for logging).
+ * @param pool   Pool used for allocation of returned table.
+ * @param path   Path to file or directory.
+ * @return       Table alias - IOR string or name, NULL in case of failure.
+ */
+static apr_table_t *ior_file_read(server_rec *s, apr_pool_t *pool,
+        const char *path)
+{
+    apr_array_header_t *files = apr_array_make(pool, 4, sizeof(const char *));
+    apr_table_t    *entries;
+    apr_finfo_t     finfo;
+    apr_file_t     *f;
+    apr_dir_t      *dir;
+    apr_status_t    rv;
+    char            line[8192];
+    int             i;
+
+    entries = apr_table_make(pool, 5);
+    rv = apr_stat(&finfo, path, APR_FINFO_TYPE, pool);
+    if (APR_STATUS_IS_ENOENT(rv)) {
+        ap_log_error(APLOG_MARK, APLOG_INFO, 0, s,
+            "mod_corba: IOR file '%s' does not exist, no objects mapped.",
+            path);
+        return entries;
+    }
+    if (rv != APR_SUCCESS) {
+        ap_log_error(APLOG_MARK, APLOG_ERR, rv, s,
+            "mod_corba: could not stat IOR file '%s'.", path);
+        return NULL;
+    }
+    if (finfo.filetype == APR_DIR) {
+        if ((rv = apr_dir_open(&dir, path, pool)) != APR_SUCCESS) {
+            ap_log_error(APLOG_MARK, APLOG_ERR, rv, s,
+                "mod_corba: could not open IOR directory '%s'.", path);
+            return NULL;
+        }
+        while (apr_dir_read(&finfo, APR_FINFO_NAME | APR_FINFO_TYPE,
+                    dir) == APR_SUCCESS) {
+            if (finfo.filetype == APR_REG && finfo.name[0] != '.')
+                APR_ARRAY_PUSH(files, const char *) =
+                    apr_pstrcat(pool, path, "/", finfo.name, NULL);
+        }
+        apr_dir_close(dir);
+    }
+    else {
+        APR_ARRAY_PUSH(files, const char *) = path;
+    }
+
+    for (i = 0; i < files->nelts; i++) {
+        const char *file = APR_ARRAY_IDX(files, i, const char *);
+
+        rv = apr_file_open(&f, file, APR_READ | APR_BUFFERED,
+                APR_OS_DEFAULT, pool);
+        /* file removed since stat, its objects are not mapped */
+        if (APR_STATUS_IS_ENOENT(rv))
+            continue;
+        if (rv != APR_SUCCESS) {
+            ap_log_error(APLOG_MARK, APLOG_ERR, rv, s,
+                "mod_corba: could not open IOR file '%s'.", file);
+            return NULL;
+        }
+        while (apr_file_gets(line, sizeof line, f) == APR_SUCCESS) {
+            char *last;
+            char *alias = apr_strtok(line, " \t\r\n", &last);
+            char *value = apr_strtok(NULL, " \t\r\n", &last);
+
+            if (alias == NULL || alias[0] == '#')
+                continue;
+            if (value == NULL) {
+                ap_log_error(APLOG_MARK, APLOG_WARNING, 0, s,
+                    "mod_corba: alias '%s' without IOR or name in '%s'.",
+                    alias, file);
+                continue;
+            }
+            apr_table_set(entries, alias, value);
+        }
+        apr_file_close(f);
+    }
+    return entries;
+}
+
+/**
+ * Function replaces names of objects read from IOR file by their IOR
+ * strings obtained from nameservice. Entries which can not be resolved
+ * are left out.
+ *
+ * @param s        Main server.
+ * @param pool     Pool used for allocation of returned table.
+ * @param sc       Configuration of main server.
+ * @param entries  Table alias - IOR string or name.
+ * @return         Table alias - IOR string.
+ */
+static apr_table_t *ior_file_resolve(server_rec *s, apr_pool_t *pool,
+        corba_conf *sc, apr_table_t *entries)
+{
+    const apr_array_header_t *elts = apr_table_elts(entries);
+    const apr_table_entry_t  *entry = (const apr_table_entry_t *) elts->elts;
+    CosNaming_NamingContext   nameservice = CORBA_OBJECT_NIL;
+    CORBA_Environment         ev[1];
+    apr_table_t              *iors = apr_table_make(pool, elts->nelts);
+    int                       i;
+
+    CORBA_exception_init(ev);
+    for (i = 0; i < elts->nelts; i++) {
+        CORBA_Object  service;
+        char         *ior;
+
+        if (strncmp(entry[i].val, "IOR:", 4) == 0 ||
+            strncmp(entry[i].val, "corbaloc:", 9) == 0) {
+            apr_table_set(iors, entry[i].key, entry[i].val);
+            continue;
+        }
+        if (nameservice == CORBA_OBJECT_NIL) {
+            nameservice = (CosNaming_NamingContext)
+                CORBA_ORB_string_to_object(orb, apr_psprintf(pool,
+                    "corbaloc::%s/NameService",
+                    sc->ns_loc ? sc->ns_loc : "localhost"), ev);
+            if (nameservice == CORBA_OBJECT_NIL || raised_exception(ev)) {
+                ap_log_error(APLOG_MARK, APLOG_ERR, 0, s,
+                    "mod_corba: could not obtain reference to "
+                    "CORBA nameservice: %s.",
+                    (ev->_id) ? ev->_id : "Unknown error");
+                CORBA_exception_free(ev);
+                return iors;
+            }
+        }
+        service = get_reference_for_service(s, pool, nameservice,
+                entry[i].val);
+        if (service == NULL)
+            continue;
+        ior = CORBA_ORB_object_to_string(orb, service, ev);
+        if (!raised_exception(ev)) {
+            apr_table_set(iors, entry[i].key, ior);
+            CORBA_free(ior);
+        }
+        CORBA_exception_free(ev);
+        CORBA_Object_release(service, ev);
+        CORBA_exception_free(ev);
+    }
+    if (nameservice != CORBA_OBJECT_NIL) {
+        CORBA_Object_release(nameservice, ev);
+        CORBA_exception_free(ev);
+    }
+    return iors;
+}
+
+/**
+ * Function reads IOR file and applies its content to IOR cache of child.
+ * Objects from the file take precedence over objects from nameservice,
+ * objects removed from the file are resolved in nameservice again on their
+ * next access. The change is published as a new generation of cache.
+ *
+ * @param s      Main server.
+ * @param sc     Configuration of main server.
+ */
+static void ior_file_apply(server_rec *s, corba_conf *sc)
+{
+    const apr_array_header_t *elts;
+    const apr_table_entry_t  *entry;
+    apr_pool_t               *pool;
+    apr_pool_t               *old_pool;
+    apr_table_t              *entries;
+    apr_table_t              *iors;
+    ior_gen_t                *gen;
+    int                       i;
+
+    if (apr_pool_create_unmanaged_ex(&pool, NULL, NULL) != APR_SUCCESS)
+        return;
+    if ((entries = ior_file_read(s, pool, sc->ior_file)) == NULL) {
+        apr_pool_destroy(pool);
+        return;
+    }
+    iors = ior_file_resolve(s, pool, sc, entries);
+
+    cache_lock();
+    if ((gen = ior_gen_copy(cache->current, NULL)) == NULL) {
+        cache_unlock();
+        apr_pool_destroy(pool);
+        return;
+    }
+    if (cache->file_iors != NULL) {
+        elts  = apr_table_elts(cache->file_iors);
+        entry = (const apr_table_entry_t *) elts->elts;
+        for (i = 0; i < elts->nelts; i++) {
+            if (apr_table_get(iors, entry[i].key) == NULL)
+                apr_table_unset(gen->iors, entry[i].key);
+        }
+    }
+    old_pool         = cache->file_pool;
+    cache->file_pool = pool;
+    cache->file_iors = iors;
+    ior_gen_overlay_file(gen);
+    ior_cache_publish(gen);
+    cache_unlock();
+    if (old_pool != NULL)
+        apr_pool_destroy(old_pool);
+
+    ap_log_error(APLOG_MARK, APLOG_INFO, 0, s,
+        "mod_corba: %d object(s) of IOR file '%s' applied to IOR cache.",
+        apr_table_elts(iors)->nelts, sc->ior_file);
+}
+
+#if APR_HAS_THREADS && defined(HAVE_SYS_INOTIFY_H)
+/** Interval in which file watcher checks whether it should stop (msec). */
+#define WATCH_POLL_MSEC         100
+
+/**
+ * State of IOR file watcher of child.
+ */
+typedef struct {
+    server_rec             *s;          /**< Main server. */
+    corba_conf             *sc;         /**< Configuration of main server. */
+    volatile apr_uint32_t   stop;       /**< Set on child exit. */
+    apr_thread_t           *thread;     /**< Watcher thread. */
+} watcher_t;
+
+/**
+ * Thread of IOR file watcher. Directory of IOR file (or the directory given
+ * by CorbaIORFile) is watched by inotify and the file is applied to IOR
+ * cache whenever it is written, replaced or deleted.
+ *
+ * @param thd   Thread.
+ * @param data  Watcher.
+ * @return      NULL.
+ */
+static void * APR_THREAD_FUNC watcher_thread(apr_thread_t *thd, void *data)
+{
+    watcher_t      *watcher = data;
+    const char     *path = watcher->sc->ior_file;
+    const char     *base = NULL;
+    char           *dir;
+    char            buf[4096]
+        __attribute__((aligned(__alignof__(struct inotify_event))));
+    apr_pool_t     *pool;
+    apr_finfo_t     finfo;
+    struct pollfd   pfd;
+    int             fd;
+
+    if (apr_pool_create(&pool, NULL) != APR_SUCCESS) {
+        apr_thread_exit(thd, APR_EGENERAL);
+        return NULL;
+    }
+
+    /* files are usually replaced by rename, so directory is watched */
+    dir = apr_pstrdup(pool, path);
+    if (apr_stat(&finfo, path, APR_FINFO_TYPE, pool) != APR_SUCCESS ||
+        finfo.filetype != APR_DIR) {
+        char *slash = strrchr(dir, '/');
+
+        base = (slash != NULL) ? slash + 1 : path;
+        if (slash == NULL)
+            dir = ".";
+        else if (slash == dir)
+            dir = "/";
+        else
+            *slash = '\0';
+    }
+
+    fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd < 0 || inotify_add_watch(fd, dir, IN_CLOSE_WRITE | IN_MOVED_TO |
+                IN_MOVED_FROM | IN_DELETE) < 0) {
+        ap_log_error(APLOG_MARK, APLOG_ERR, errno, watcher->s,
+            "mod_corba: could not watch '%s', IOR file is read only at "
+            "start of child.", dir);
+        if (fd >= 0)
+            close(fd);
+        ior_file_apply(watcher->s, watcher->sc);
+        apr_pool_destroy(pool);
+        apr_thread_exit(thd, APR_EGENERAL);
+        return NULL;
+    }
+
+    ior_file_apply(watcher->s, watcher->sc);
+    while (!apr_atomic_read32(&watcher->stop)) {
+        ssize_t len;
+        int     changed = 0;
+
+        pfd.fd     = fd;
+        pfd.events = POLLIN;
+        if (poll(&pfd, 1, WATCH_POLL_MSEC) <= 0)
+            continue;
+        while ((len = read(fd, buf, sizeof buf)) > 0) {
+            const char *p;
+
+            for (p = buf; p < buf + len;) {
+                const struct inotify_event *event =
+                    (const struct inotify_event *) p;
+
+                if (base == NULL ||
+                    (event->len > 0 && strcmp(event->name, base) == 0))
+                    changed = 1;
+                p += sizeof(struct inotify_event) + event->len;
+            }
+        }
+        if (changed)
+            ior_file_apply(watcher->s, watcher->sc);
+    }
+    close(fd);
+    apr_pool_destroy(pool);
+    apr_thread_exit(thd, APR_SUCCESS);
+    return NULL;
+}
+
+/**
+ * Cleanup routine stops IOR file watcher. It is registered as pre-cleanup,
+ * so it runs before the ORB and the cache are destroyed by cleanups of
+ * child pool.
+ *
+ * @param data   Watcher.
+ */
+static apr_status_t watcher_cleanup(void *data)
+{
+    watcher_t      *watcher = data;
+    apr_status_t    rv;
+
+    apr_atomic_set32(&watcher->stop, 1);
+    apr_thread_join(&rv, watcher->thread);
+    return APR_SUCCESS;
+}
+#endif
+
+/**
+ * Function applies IOR file to IOR cache of child and starts watcher
+ * which applies its later changes (if inotify is available).
+ *
+ * @param p     Child pool.
+ * @param s     Main server record.
+ * @param sc    Configuration of main server.
+ */
+static void corba_watcher_start(apr_pool_t *p, server_rec *s, corba_conf *sc)
+{
+#if APR_HAS_THREADS && defined(HAVE_SYS_INOTIFY_H)
+    watcher_t      *watcher = apr_pcalloc(p, sizeof *watcher);
+    apr_status_t    rv;
+
+    watcher->s    = s;
+    watcher->sc   = sc;
+    watcher->stop = 0;
+
+    rv = apr_thread_create(&watcher->thread, NULL, watcher_thread, watcher, p);
+    if (rv == APR_SUCCESS) {
+        apr_pool_pre_cleanup_register(p, watcher, watcher_cleanup);
+        return;
+    }
+    ap_log_error(APLOG_MARK, APLOG_ERR, rv, s,
+        "mod_corba: could not start IOR file watcher.");
+#endif
+    ior_file_apply(s, sc);
+}
+
+/**
+ * Cleanup routine releases ORB.
+ *
+ * This routine is called upon destroying child pool (which is at child
+ * exit).
+ *
+ * @param par_orb  The ORB.
+ */
+static apr_status_t corba_cleanup(void *par_orb)
+{
+	CORBA_Environment ev[1];
+	CORBA_ORB	child_orb = (CORBA_ORB) par_orb;
+
+	CORBA_exception_init(ev);
+
+	orb = NULL;
+	/* tear down the ORB */
+	CORBA_ORB_destroy(child_orb, ev);
+	if (raised_exception(ev)) {
+		ap_log_error(APLOG_MARK, APLOG_ERR, 0, NULL,
+			"mod_corba: error when releasing ORB: %s.", ev->_id);
+		CORBA_exception_free(ev);
+		return APR_EGENERAL;
+	}
+	ap_log_error(APLOG_MARK, APLOG_DEBUG, 0, NULL,
+			"mod_corba: child ORB released");
+	return APR_SUCCESS;
+}
+
+/**
+ * Function decides whether an object belongs to the effective set of objects
+ * of a server as restricted by CorbaObjectScope and CorbaObjectExclude.
+ *
+ * @param sc     Server configuration.
+ * @param alias  Alias of object.
+ * @return       1 if object is managed for the server, 0 otherwise.
+ */
+static int corba_object_in_scope(const corba_conf *sc, const char *alias)
+{
+    if (sc->scope != NULL && apr_table_get(sc->scope, alias) == NULL)
+        return 0;
+    return (apr_table_get(sc->exclude, alias) == NULL);
+}
+
+/**
+ * Context structure passed between post config hook and scope_object().
+ */
+struct scope_objects_ctx {
+    const corba_conf   *sc;         /**< Server configuration. */
+    apr_table_t        *objects;    /**< Effective set of objects. */
+};
+
+/**
+ * Function copies one object to effective set of objects if it is in scope.
+ *
+ * @param pctx    Context pointer.
+ * @param alias   Alias of object.
+ * @param name    Name of object.
+ * @return        Always 1 (continue iteration).
+ */
+static int scope_object(void *pctx, const char *alias, const char *name)
+{
+    struct scope_objects_ctx *ctx = pctx;
+
+    if (corba_object_in_scope(ctx->sc, alias))
+        apr_table_setn(ctx->objects, alias, name);
+    return 1;
+}
+
+/**
+ * Function sets up limits of concurrent calls configured by
+ * CorbaMaxConcurrent in shared memory.
+ *
+ * @param p   Configuration pool.
+ * @param s   Main server.
+ */
+static void corba_limits_init(apr_pool_t *p, server_rec *s)
+{
+    corba_conf  *sc = (corba_conf *)
+        ap_get_module_config(s->module_config, &corba_module);
+    int          i;
+
+    limits = apr_hash_make(p);
+    for (i = 0; i < sc->limits->nelts && i < LIMIT_SLOTS; i++) {
+        limit_conf_t *lc  = &APR_ARRAY_IDX(sc->limits, i, limit_conf_t);
+        limit_t      *lim = &shared->limits[i];
+
+        apr_cpystrn(lim->alias, lc->alias, CALL_NAME_LEN);
+        lim->limit = lc->limit;
+        lim->queue = lc->queue;
+        lim->wait  = sc->queue_timeout;
+        lim->sockets_max = lc->sockets;
+        apr_hash_set(limits, lc->alias, APR_HASH_KEY_STRING, lim);
+    }
+}
+
+/**
+ * In post config hook we only validate configuration and set defaults, ORB
+ * is created per child in child init (see corba_orb_init()).
+ *
+ * @param p     Memory pool.
+ * @param plog  Memory pool used for logging.
+ * @param ptemp Memory pool destroyed right after postconfig phase.
+ * @param s     Server record.
+ * @return      Status.
+ */
+static int corba_postconfig_hook(apr_pool_t *p, __attribute__((unused)) apr_pool_t *plog,
+		 __attribute__((unused)) apr_pool_t *ptemp, server_rec *s)
+{
+	corba_conf	       *sc;
+	apr_shm_t          *shm;
+	apr_status_t        rv;
+
+    void *data;
+    const char *userdata_key = "corba_init_module";
+
+    apr_pool_userdata_get(&data, userdata_key, s->process->pool);
+    if (!data) {
+        apr_pool_userdata_set((const void *)1, userdata_key,
+            apr_pool_cleanup_null, s->process->pool);
+        //return OK;
+    }
+
+	/*
+	 * Shared memory for requests of IOR cache flush; anonymous segment
+	 * is inherited by children and destroyed with configuration pool.
+	 */
+	rv = apr_shm_create(&shm, sizeof(corba_shared_t), NULL, p);
+	if (rv == APR_SUCCESS) {
+		shared = apr_shm_baseaddr_get(shm);
+		memset(shared, 0, sizeof(corba_shared_t));
+		corba_limits_init(p, s);
+	}
+	else {
+		shared = NULL;
+		ap_log_error(APLOG_MARK, APLOG_ERR, rv, s,
+			"mod_corba: could not create shared memory, "
+			"runtime flush of IOR cache is not available.");
+	}
+
+	/*
+	 * Iterate through available servers and if corba is enabled
+	 * set defaults and effective set of objects for that server.
+	 */
+	while (s != NULL) {
+		sc = (corba_conf *) ap_get_module_config(s->module_config,
+				&corba_module);
+
+		if (sc->enabled) {
+			/* set default values for object lookup data */
+			if (sc->ns_loc == NULL)
+				sc->ns_loc = apr_pstrdup(p, "localhost");
+			if (sc->resolve_threads == 0)
+				sc->resolve_threads = 4;
+			/* resolve only objects the server actually uses */
+			if (sc->scope != NULL || !apr_is_empty_table(sc->exclude)) {
+				struct scope_objects_ctx sctx;
+
+				sctx.sc      = sc;
+				sctx.objects = apr_table_make(p, 5);
+				apr_table_do(scope_object, &sctx, sc->objects, NULL);
+				sc->objects  = sctx.objects;
+				ap_log_error(APLOG_MARK, APLOG_DEBUG, 0, s,
+					"mod_corba: %d object(s) in scope of server",
+					apr_table_elts(sc->objects)->nelts);
+			}
+			if (apr_is_empty_table(sc->objects) &&
+			    apr_is_empty_array(sc->contexts))
+				ap_log_error(APLOG_MARK, APLOG_WARNING, 0, s,
+					"mod_corba: module enabled but no "
+					"objects to manage were configured!");
+        }
+		s = s->next;
+	}
+    
+   ap_log_error(APLOG_MARK, APLOG_NOTICE, 0, s, "mod_corba started (mod_corba "
+            "version %s, GIT revision %s, BUILT %s %s)",
+            MOD_VERSION, GIT_REVISION, __DATE__, __TIME__);
+
+	return OK;
+}
+
+
+/**
+ * Handler for apache's configuration directive "CorbaEnable".
+ *
+ * @param cmd    Command structure.
+ * @param dummy  Not used parameter.
+ * @param flag   1 means Corba is turned on, 0 means turned off.
+ * @return       Error string in case of failure otherwise NULL.
+ */
+static const char *set_corba(cmd_parms *cmd, __attribute__((unused)) void *dummy, int flag)
+{
+	server_rec *s = cmd->server;
+	corba_conf *sc = (corba_conf *)
+		ap_get_module_config(s->module_config, &corba_module);
+
+	const char *err = ap_check_cmd_context(cmd,
+			NOT_IN_DIR_LOC_FILE | NOT_IN_LIMIT);
+	if (err)
+		return err;
+
+	sc->enabled = flag;
+	return NULL;
+}
+
+/**
+ * Handler for apache's configuration directive "CorbaEnable".
+ *
+ * @param cmd    Command structure.
+ * @param dummy  Not used parameter.
+ * @param flag   1 means Corba is turned on, 0 means turned off.
+ * @return       Error string in case of failure otherwise NULL.
+ */
+static const char *set_ior_cache(cmd_parms *cmd, __attribute__((unused)) void *dummy, int flag)
+{
+	server_rec *s = cmd->server;
+	corba_conf *sc = (corba_conf *)
+		ap_get_module_config(s->module_config, &corba_module);
+
+	const char *err = ap_check_cmd_context(cmd,
+			NOT_IN_DIR_LOC_FILE | NOT_IN_LIMIT);
+	if (err)
+		return err;
+
+	sc->ior_cache_enabled = flag;
+	return NULL;
+}
+
+/**
+ * Handler for apache's configuration directive "CorbaEarlyAcquire".
+ *
+ * @param cmd    Command structure.
+ * @param dummy  Not used parameter.
+ * @param flag   1 means early acquisition is turned on, 0 means turned off.
+ * @return       Error string in case of failure otherwise NULL.
+ */
+static const char *set_early_acquire(cmd_parms *cmd, __attribute__((unused)) void *dummy, int flag)
+{
+	server_rec *s = cmd->server;
+	corba_conf *sc = (corba_conf *)
+		ap_get_module_config(s->module_config, &corba_module);
+
+	const char *err = ap_check_cmd_context(cmd,
+			NOT_IN_DIR_LOC_FILE | NOT_IN_LIMIT);
+	if (err)
+		return err;
+
+	sc->early_acquire = flag;
+	return NULL;
+}
+
+/**
+ * Handler for apache's configuration directive "CorbaNameservice".
+ * Sets the host and optional port where nameservice runs.
+ *
+ * @param cmd    Command structure.
+ * @param dummy  Not used parameter.
+ * @param ns_loc The host [port] of nameservice.
+ * @return       Error string in case of failure otherwise NULL.
+ */
+static const char *set_nameservice(cmd_parms *cmd, __attribute__((unused)) void *dummy,
+		const char *ns_loc)
+{
+	const char *err;
+	server_rec *s = cmd->server;
+	corba_conf *sc = (corba_conf *)
+		ap_get_module_config(s->module_config, &corba_module);
+
+	err = ap_check_cmd_context(cmd, NOT_IN_DIR_LOC_FILE|NOT_IN_LIMIT);
+	if (err)
+		return err;
+
+	/*
+	 * catch double definition of location
+	 * that's not serious fault so we will just print message in log
+	 */
+	if (sc->ns_loc != NULL) {
+		ap_log_error(APLOG_MARK, APLOG_ERR, 0, s,
+			"mod_corba: more than one definition of nameserice "
+			"location. All but the first one will be ignored");
+		return NULL;
+	}
+
+	sc->ns_loc = ns_loc;
+
+	return NULL;
+}
+
+/**
+ * Handler for apache's configuration directive "CorbaObject".
+ * Sets a name of CORBA object which will be managed by this module.
+ *
+ * @param cmd      Command structure.
+ * @param dummy    Not used parameter.
+ * @param object   A name of object.
+ * @return         Error string in case of failure otherwise NULL.
+ */
+static const char *set_object(cmd_parms *cmd, __attribute__((unused)) void *dummy, 
+      const char *object, const char *alias)
+{
+	const char  *err;
+	server_rec  *s = cmd->server;
+	corba_conf  *sc = (corba_conf *)
+		ap_get_module_config(s->module_config, &corba_module);
+
+	err = ap_check_cmd_context(cmd, NOT_IN_DIR_LOC_FILE|NOT_IN_LIMIT);
+	if (err)
+		return err;
+
+	apr_table_set(sc->objects, alias, object);
+
+	return NULL;
+}
+
+/**
+ * Handler for apache's configuration directive "CorbaResolveThreads".
+ * Sets maximal number of threads resolving objects on IOR cache fill.
+ *
+ * @param cmd      Command structure.
+ * @param dummy    Not used parameter.
+ * @param value    Number of threads.
+ * @return         Error string in case of failure otherwise NULL.
+ */
+static const char *set_resolve_threads(cmd_parms *cmd, __attribute__((unused)) void *dummy,
+      const char *value)
+{
+	const char  *err;
+	server_rec  *s = cmd->server;
+	corba_conf  *sc = (corba_conf *)
+		ap_get_module_config(s->module_config, &corba_module);
+
+	err = ap_check_cmd_context(cmd, NOT_IN_DIR_LOC_FILE|NOT_IN_LIMIT);
+	if (err)
+		return err;
+
+	sc->resolve_threads = atoi(value);
+	if (sc->resolve_threads < 1 || sc->resolve_threads > 64)
+		return "CorbaResolveThreads must be a number from 1 to 64";
+
+	return NULL;
+}
+
+/**
+ * Handler for apache's configuration directive "CorbaObjectContext".
+ * Sets a context all objects of which will be managed by this module.
+ *
+ * @param cmd      Command structure.
+ * @param dummy    Not used parameter.
+ * @param context  A name of context optionally followed by ".*".
+ * @return         Error string in case of failure otherwise NULL.
+ */
+static const char *set_object_context(cmd_parms *cmd, __attribute__((unused)) void *dummy,
+      const char *context)
+{
+	const char  *err;
+	size_t       len;
+	server_rec  *s = cmd->server;
+	corba_conf  *sc = (corba_conf *)
+		ap_get_module_config(s->module_config, &corba_module);
+
+	err = ap_check_cmd_context(cmd, NOT_IN_DIR_LOC_FILE|NOT_IN_LIMIT);
+	if (err)
+		return err;
+
+	len = strlen(context);
+	if (len > 2 && strcmp(context + len - 2, ".*") == 0)
+		len -= 2;
+	if (len == 0 || memchr(context, '.', len) != NULL)
+		return "CorbaObjectContext must be in format CONTEXTNAME.*";
+
+	APR_ARRAY_PUSH(sc->contexts, const char *) =
+		apr_pstrmemdup(cmd->pool, context, len);
+
+	return NULL;
+}
+
+/**
+ * Handler for apache's configuration directive "CorbaProbeInterval".
+ * Sets interval of background liveness probes of cached objects.
+ *
+ * @param cmd      Command structure.
+ * @param dummy    Not used parameter.
+ * @param value    Interval in seconds, 0 disables probes.
+ * @return         Error string in case of failure otherwise NULL.
+ */
+static const char *set_probe_interval(cmd_parms *cmd, __attribute__((unused)) void *dummy,
+      const char *value)
+{
+	const char  *err;
+	server_rec  *s = cmd->server;
+	corba_conf  *sc = (corba_conf *)
+		ap_get_module_config(s->module_config, &corba_module);
+
+	err = ap_check_cmd_context(cmd, GLOBAL_ONLY);
+	if (err)
+		return err;
+
+	sc->probe_interval = atoi(value);
+	if (sc->probe_interval < 0)
+		return "CorbaProbeInterval must be a non-negative number";
+
+	return NULL;
+}
+
+/**
+ * Function returns configured limits of object, new limits (without any
+ * restriction) are added if the object has none yet.
+ *
+ * @param cmd      Command structure.
+ * @param alias    Alias of object.
+ * @return         Limits, NULL if too many objects are limited.
+ */
+static limit_conf_t *get_limit_conf(cmd_parms *cmd, const char *alias)
+{
+	corba_conf   *sc = (corba_conf *)
+		ap_get_module_config(cmd->server->module_config, &corba_module);
+	limit_conf_t *lc;
+	int           i;
+
+	for (i = 0; i < sc->limits->nelts; i++) {
+		lc = &APR_ARRAY_IDX(sc->limits, i, limit_conf_t);
+		if (strcmp(lc->alias, alias) == 0)
+			return lc;
+	}
+	if (sc->limits->nelts >= LIMIT_SLOTS)
+		return NULL;
+	lc = &APR_ARRAY_PUSH(sc->limits, limit_conf_t);
+	lc->alias   = alias;
+	lc->limit   = 0;
+	lc->queue   = 0;
+	lc->sockets = 0;
+	return lc;
+}
+
+/**
+ * Handler for apache's configuration directive "CorbaMaxConcurrent".
+ * Limits number of concurrent calls of object in all children.
+ *
+ * @param cmd      Command structure.
+ * @param dummy    Not used parameter.
+ * @param alias    Alias of object.
+ * @param limit    Maximal number of concurrent calls.
+ * @param queue    Maximal number of waiting calls (NULL means 0).
+ * @return         Error string in case of failure otherwise NULL.
+ */
+static const char *set_max_concurrent(cmd_parms *cmd, __attribute__((unused)) void *dummy,
+      const char *alias, const char *limit, const char *queue)
+{
+	const char   *err;
+	limit_conf_t *lc;
+
+	err = ap_check_cmd_context(cmd, GLOBAL_ONLY);
+	if (err)
+		return err;
+
+	if ((lc = get_limit_conf(cmd, alias)) == NULL)
+		return apr_psprintf(cmd->pool, "Limits may be configured for at "
+				"most %d objects", LIMIT_SLOTS);
+	lc->limit = atoi(limit);
+	lc->queue = (queue != NULL) ? atoi(queue) : 0;
+	if (lc->limit < 1)
+		return "CorbaMaxConcurrent limit must be a positive number";
+	if (lc->queue < 0)
+		return "CorbaMaxConcurrent queue must not be negative";
 
-	return DECLINED;
+	return NULL;
 }
 
 /**
- * Cleanup routine releases ORB.
- *
- * This routine is called upon destroying configuration pool (which is at
- * restarts).
+ * Handler for apache's configuration directive "CorbaMaxBackendSockets".
+ * Limits number of GIOP connections to object from all children.
  *
- * @param par_orb  The ORB.
+ * @param cmd      Command structure.
+ * @param dummy    Not used parameter.
+ * @param alias    Alias of object.
+ * @param sockets  Maximal number of connections.
+ * @return         Error string in case of failure otherwise NULL.
  */
-static apr_status_t corba_cleanup(void *par_orb)
+static const char *set_max_sockets(cmd_parms *cmd, __attribute__((unused)) void *dummy,
+      const char *alias, const char *sockets)
 {
-	CORBA_Environment ev[1];
-	CORBA_ORB	orb = (CORBA_ORB) par_orb;
+	const char   *err;
+	limit_conf_t *lc;
 
-	CORBA_exception_init(ev);
+	err = ap_check_cmd_context(cmd, GLOBAL_ONLY);
+	if (err)
+		return err;
 
-	/* tear down the ORB */
-	CORBA_ORB_destroy(orb, ev);
-	if (raised_exception(ev)) {
-		ap_log_error(APLOG_MARK, APLOG_ERR, 0, NULL,
-			"mod_corba: error when releasing ORB: %s.", ev->_id);
-		CORBA_exception_free(ev);
-		return APR_EGENERAL;
-	}
-	ap_log_error(APLOG_MARK, APLOG_DEBUG, 0, NULL,
-			"mod_corba: global ORB released");
-	return APR_SUCCESS;
+	if ((lc = get_limit_conf(cmd, alias)) == NULL)
+		return apr_psprintf(cmd->pool, "Limits may be configured for at "
+				"most %d objects", LIMIT_SLOTS);
+	lc->sockets = atoi(sockets);
+	if (lc->sockets < 1)
+		return "CorbaMaxBackendSockets must be a positive number";
+
+	return NULL;
 }
 
 /**
- * In post config hook we initialize ORB
+ * Handler for apache's configuration directive "CorbaGIOPIdleTimeout".
+ * Sets duration after which GIOP connection of object which is not called
+ * is closed.
  *
- * @param p     Memory pool.
- * @param plog  Memory pool used for logging.
- * @param ptemp Memory pool destroyed right after postconfig phase.
- * @param s     Server record.
- * @return      Status.
+ * @param cmd      Command structure.
+ * @param dummy    Not used parameter.
+ * @param value    Timeout in seconds.
+ * @return         Error string in case of failure otherwise NULL.
  */
-static int corba_postconfig_hook(apr_pool_t *p, __attribute__((unused)) apr_pool_t *plog,
-		 __attribute__((unused)) apr_pool_t *ptemp, server_rec *s)
+static const char *set_idle_timeout(cmd_parms *cmd, __attribute__((unused)) void *dummy,
+      const char *value)
 {
-	corba_conf	       *sc;
-	CORBA_ORB	        orb;
-	CORBA_Environment	ev[1];
-	int orb_argc = 2;
-	char *orb_argv[] = {"dummy", "--GIOPTimeoutMSEC=0", NULL};
+	const char  *err;
+	server_rec  *s = cmd->server;
+	corba_conf  *sc = (corba_conf *)
+		ap_get_module_config(s->module_config, &corba_module);
 
-    void *data;
-    const char *userdata_key = "corba_init_module";
+	err = ap_check_cmd_context(cmd, GLOBAL_ONLY);
+	if (err)
+		return err;
 
-    apr_pool_userdata_get(&data, userdata_key, s->process->pool);
-    if (!data) {
-        apr_pool_userdata_set((const void *)1, userdata_key,
-            apr_pool_cleanup_null, s->process->pool);
-        //return OK;
-    }
+	sc->idle_timeout = atoi(value);
+	if (sc->idle_timeout < 0)
+		return "CorbaGIOPIdleTimeout must not be negative";
 
-    /*
-	 * do initialization of corba
-	 */
-	CORBA_exception_init(ev);
-	
-    /* create orb object */
-	orb = CORBA_ORB_init(&orb_argc, orb_argv, "orbit-local-orb", ev);
-	if (raised_exception(ev)) {
-		ap_log_error(APLOG_MARK, APLOG_CRIT, 0, s,
-			"mod_corba: could not create ORB: %s.", ev->_id);
-		CORBA_exception_free(ev);
-		return HTTP_INTERNAL_SERVER_ERROR;
-	}
-	/* register cleanup for ORB */
-	apr_pool_cleanup_register(p, orb, corba_cleanup,
-			apr_pool_cleanup_null);
-	ap_log_error(APLOG_MARK, APLOG_DEBUG, 0, s,
-			"mod_corba: global ORB initialized");
+	return NULL;
+}
 
-	/*
-	 * Iterate through available servers and if corba is enabled
-	 * initialize ORB reference for that server.
-	 */
-	while (s != NULL) {
-		sc = (corba_conf *) ap_get_module_config(s->module_config,
-				&corba_module);
+/**
+ * Handler for apache's configuration directive "CorbaQueueTimeout".
+ * Sets duration after which a call waiting for admission is rejected.
+ *
+ * @param cmd      Command structure.
+ * @param dummy    Not used parameter.
+ * @param value    Timeout in milliseconds.
+ * @return         Error string in case of failure otherwise NULL.
+ */
+static const char *set_queue_timeout(cmd_parms *cmd, __attribute__((unused)) void *dummy,
+      const char *value)
+{
+	const char  *err;
+	server_rec  *s = cmd->server;
+	corba_conf  *sc = (corba_conf *)
+		ap_get_module_config(s->module_config, &corba_module);
 
-		if (sc->enabled) {
-			/* set default values for object lookup data */
-			if (sc->ns_loc == NULL)
-				sc->ns_loc = apr_pstrdup(p, "localhost");
-			if (apr_is_empty_table(sc->objects))
-				ap_log_error(APLOG_MARK, APLOG_WARNING, 0, s,
-					"mod_corba: module enabled but no "
-					"objects to manage were configured!");
-			sc->orb = orb;
-        }
-		s = s->next;
-	}
-    
-   ap_log_error(APLOG_MARK, APLOG_NOTICE, 0, s, "mod_corba started (mod_corba "
-            "version %s, GIT revision %s, BUILT %s %s)",
-            MOD_VERSION, GIT_REVISION, __DATE__, __TIME__);
+	err = ap_check_cmd_context(cmd, GLOBAL_ONLY);
+	if (err)
+		return err;
 
-	return OK;
-}
+	sc->queue_timeout = atoi(value);
+	if (sc->queue_timeout < 1)
+		return "CorbaQueueTimeout must be a positive number";
 
+	return NULL;
+}
 
 /**
- * Handler for apache's configuration directive "CorbaEnable".
+ * Handler for apache's configuration directive "CorbaIORFile".
  *
- * @param cmd    Command structure.
- * @param dummy  Not used parameter.
- * @param flag   1 means Corba is turned on, 0 means turned off.
- * @return       Error string in case of failure otherwise NULL.
+ * @param cmd      Command structure.
+ * @param dummy    Not used parameter.
+ * @param path     Path to file or directory.
+ * @return         Error string in case of failure otherwise NULL.
  */
-static const char *set_corba(cmd_parms *cmd, __attribute__((unused)) void *dummy, int flag)
+static const char *set_ior_file(cmd_parms *cmd, __attribute__((unused)) void *dummy,
+      const char *path)
 {
-	server_rec *s = cmd->server;
-	corba_conf *sc = (corba_conf *)
+	const char  *err;
+	server_rec  *s = cmd->server;
+	corba_conf  *sc = (corba_conf *)
 		ap_get_module_config(s->module_config, &corba_module);
 
-	const char *err = ap_check_cmd_context(cmd,
-			NOT_IN_DIR_LOC_FILE | NOT_IN_LIMIT);
+	err = ap_check_cmd_context(cmd, GLOBAL_ONLY);
 	if (err)
 		return err;
 
-	sc->enabled = flag;
+	sc->ior_file = ap_server_root_relative(cmd->pool, path);
+	if (sc->ior_file == NULL)
+		return apr_pstrcat(cmd->pool, "Invalid CorbaIORFile path ",
+				path, NULL);
+
 	return NULL;
 }
 
 /**
- * Handler for apache's configuration directive "CorbaEnable".
+ * Handler for apache's configuration directive "CorbaProbeTimeout".
+ * Sets duration after which a liveness probe is considered failed.
  *
- * @param cmd    Command structure.
- * @param dummy  Not used parameter.
- * @param flag   1 means Corba is turned on, 0 means turned off.
- * @return       Error string in case of failure otherwise NULL.
+ * @param cmd      Command structure.
+ * @param dummy    Not used parameter.
+ * @param value    Timeout in milliseconds.
+ * @return         Error string in case of failure otherwise NULL.
  */
-static const char *set_ior_cache(cmd_parms *cmd, __attribute__((unused)) void *dummy, int flag)
+static const char *set_probe_timeout(cmd_parms *cmd, __attribute__((unused)) void *dummy,
+      const char *value)
 {
-	server_rec *s = cmd->server;
-	corba_conf *sc = (corba_conf *)
+	const char  *err;
+	server_rec  *s = cmd->server;
+	corba_conf  *sc = (corba_conf *)
 		ap_get_module_config(s->module_config, &corba_module);
 
-	const char *err = ap_check_cmd_context(cmd,
-			NOT_IN_DIR_LOC_FILE | NOT_IN_LIMIT);
+	err = ap_check_cmd_context(cmd, GLOBAL_ONLY);
 	if (err)
 		return err;
 
-	sc->ior_cache_enabled = flag;
+	sc->probe_timeout = atoi(value);
+	if (sc->probe_timeout < 1)
+		return "CorbaProbeTimeout must be a positive number";
+
 	return NULL;
 }
 
 /**
- * Handler for apache's configuration directive "CorbaNameservice".
- * Sets the host and optional port where nameservice runs.
+ * Handler for apache's configuration directive "CorbaObjectScope".
+ * Restricts objects managed for the server to given aliases.
  *
- * @param cmd    Command structure.
- * @param dummy  Not used parameter.
- * @param ns_loc The host [port] of nameservice.
- * @return       Error string in case of failure otherwise NULL.
+ * @param cmd      Command structure.
+ * @param dummy    Not used parameter.
+ * @param alias    Alias of object.
+ * @return         Error string in case of failure otherwise NULL.
  */
-static const char *set_nameservice(cmd_parms *cmd, __attribute__((unused)) void *dummy,
-		const char *ns_loc)
+static const char *set_object_scope(cmd_parms *cmd, __attribute__((unused)) void *dummy,
+      const char *alias)
 {
-	const char *err;
-	server_rec *s = cmd->server;
-	corba_conf *sc = (corba_conf *)
+	const char  *err;
+	server_rec  *s = cmd->server;
+	corba_conf  *sc = (corba_conf *)
 		ap_get_module_config(s->module_config, &corba_module);
 
 	err = ap_check_cmd_context(cmd, NOT_IN_DIR_LOC_FILE|NOT_IN_LIMIT);
 	if (err)
 		return err;
 
-	/*
-	 * catch double definition of location
-	 * that's not serious fault so we will just print message in log
-	 */
-	if (sc->ns_loc != NULL) {
-		ap_log_error(APLOG_MARK, APLOG_ERR, 0, s,
-			"mod_corba: more than one definition of nameserice "
-			"location. All but the first one will be ignored");
-		return NULL;
-	}
-
-	sc->ns_loc = ns_loc;
+	if (sc->scope == NULL)
+		sc->scope = apr_table_make(cmd->pool, 5);
+	apr_table_setn(sc->scope, alias, alias);
 
 	return NULL;
 }
 
 /**
- * Handler for apache's configuration directive "CorbaObject".
- * Sets a name of CORBA object which will be managed by this module.
+ * Handler for apache's configuration directive "CorbaObjectExclude".
+ * Excludes given aliases from objects managed for the server.
  *
  * @param cmd      Command structure.
  * @param dummy    Not used parameter.
- * @param object   A name of object.
+ * @param alias    Alias of object.
  * @return         Error string in case of failure otherwise NULL.
  */
-static const char *set_object(cmd_parms *cmd, __attribute__((unused)) void *dummy, 
-      const char *object, const char *alias)
+static const char *set_object_exclude(cmd_parms *cmd, __attribute__((unused)) void *dummy,
+      const char *alias)
 {
 	const char  *err;
 	server_rec  *s = cmd->server;
@@ -759,7 +4135,48 @@ static const char *set_object(cmd_parms *cmd, __attribute__((unused)) void *dumm
 	if (err)
 		return err;
 
-	apr_table_set(sc->objects, alias, object);
+	apr_table_setn(sc->exclude, alias, alias);
+
+	return NULL;
+}
+
+/**
+ * Handler for apache's configuration directive "CorbaAdminAllow".
+ * Adds network of clients allowed to use corba-admin handler.
+ *
+ * @param cmd      Command structure.
+ * @param dummy    Not used parameter.
+ * @param network  IP address or network (address/mask or address/bits).
+ * @return         Error string in case of failure otherwise NULL.
+ */
+static const char *set_admin_allow(cmd_parms *cmd, __attribute__((unused)) void *dummy,
+      const char *network)
+{
+	const char      *err;
+	char            *ip;
+	char            *mask;
+	apr_ipsubnet_t  *ipsub;
+	apr_status_t     rv;
+	server_rec      *s = cmd->server;
+	corba_conf      *sc = (corba_conf *)
+		ap_get_module_config(s->module_config, &corba_module);
+
+	err = ap_check_cmd_context(cmd, NOT_IN_DIR_LOC_FILE|NOT_IN_LIMIT);
+	if (err)
+		return err;
+
+	ip = apr_pstrdup(cmd->temp_pool, network);
+	if ((mask = strchr(ip, '/')) != NULL)
+		*mask++ = '\0';
+	rv = apr_ipsubnet_create(&ipsub, ip, mask, cmd->pool);
+	if (rv != APR_SUCCESS)
+		return apr_pstrcat(cmd->pool, "Invalid CorbaAdminAllow network ",
+				network, NULL);
+
+	if (sc->admin_allow == NULL)
+		sc->admin_allow = apr_array_make(cmd->pool, 2,
+				sizeof(apr_ipsubnet_t *));
+	APR_ARRAY_PUSH(sc->admin_allow, apr_ipsubnet_t *) = ipsub;
 
 	return NULL;
 }
@@ -779,6 +4196,45 @@ static const command_rec corba_cmds[] = {
 	AP_INIT_TAKE2("CorbaObject", set_object, NULL, RSRC_CONF,
 		 "Context and name of object to provision and its alias. "
 		 "Format for context and name is CONTEXTNAME.OBJECTNAME."),
+	AP_INIT_ITERATE("CorbaObjectContext", set_object_context, NULL, RSRC_CONF,
+		 "Contexts all objects of which are provisioned under their "
+		 "names. Format is CONTEXTNAME.*."),
+	AP_INIT_TAKE1("CorbaResolveThreads", set_resolve_threads, NULL, RSRC_CONF,
+		 "Maximal number of threads resolving objects in parallel when "
+		 "IOR cache is filled. Default is 4."),
+	AP_INIT_FLAG("CorbaEarlyAcquire", set_early_acquire, NULL, RSRC_CONF,
+		 "Whether references are acquired already in pre_connection hook "
+		 "(in parallel with TLS handshake)"),
+	AP_INIT_TAKE1("CorbaProbeInterval", set_probe_interval, NULL, RSRC_CONF,
+		 "Seconds between background liveness probes of cached objects. "
+		 "Default is 0 (probes are disabled)."),
+	AP_INIT_TAKE1("CorbaProbeTimeout", set_probe_timeout, NULL, RSRC_CONF,
+		 "Milliseconds after which liveness probe is considered failed. "
+		 "Default is 1000."),
+	AP_INIT_TAKE23("CorbaMaxConcurrent", set_max_concurrent, NULL, RSRC_CONF,
+		 "Alias of object, maximal number of its concurrent calls and "
+		 "maximal number of calls waiting for admission (default 0)."),
+	AP_INIT_TAKE2("CorbaMaxBackendSockets", set_max_sockets, NULL, RSRC_CONF,
+		 "Alias of object and maximal number of GIOP connections to it "
+		 "from all children."),
+	AP_INIT_TAKE1("CorbaGIOPIdleTimeout", set_idle_timeout, NULL, RSRC_CONF,
+		 "Seconds after which GIOP connection of object which is not "
+		 "called is closed. Default is 0 (connections are not closed)."),
+	AP_INIT_TAKE1("CorbaQueueTimeout", set_queue_timeout, NULL, RSRC_CONF,
+		 "Milliseconds a call waits for admission before it is rejected. "
+		 "Default is 100."),
+	AP_INIT_TAKE1("CorbaIORFile", set_ior_file, NULL, RSRC_CONF,
+		 "File (or directory of files) with IORs or names of objects, "
+		 "changes of which are applied to IOR cache."),
+	AP_INIT_ITERATE("CorbaObjectScope", set_object_scope, NULL, RSRC_CONF,
+		 "Aliases of objects to which the server is restricted. "
+		 "By default all configured and inherited objects are managed."),
+	AP_INIT_ITERATE("CorbaObjectExclude", set_object_exclude, NULL, RSRC_CONF,
+		 "Aliases of configured or inherited objects which are not "
+		 "managed for the server."),
+	AP_INIT_ITERATE("CorbaAdminAllow", set_admin_allow, NULL, RSRC_CONF,
+		 "IP addresses or networks of clients allowed to use corba-admin "
+		 "handler. Default is localhost only."),
 	AP_INIT_NO_ARGS(NULL, NULL, NULL, 0, NULL) /* NULL-terminator, avoids 'missing field initializers' warning  */
 };
 
@@ -792,8 +4248,19 @@ static void *create_corba_config(apr_pool_t *p, __attribute__((unused)) server_r
 	sc->enabled = 0;
     sc->ior_cache_enabled = 1;
 	sc->ns_loc = NULL;
-	sc->orb = NULL;
     sc->objects = apr_table_make(p, 5);
+	sc->scope = NULL;
+	sc->exclude = apr_table_make(p, 5);
+	sc->resolve_threads = 0;
+	sc->contexts = apr_array_make(p, 2, sizeof(const char *));
+	sc->probe_interval = 0;
+	sc->probe_timeout = 1000;
+	sc->early_acquire = 0;
+	sc->limits = apr_array_make(p, 2, sizeof(limit_conf_t));
+	sc->queue_timeout = 100;
+	sc->ior_file = NULL;
+	sc->idle_timeout = 0;
+	sc->admin_allow = NULL;
 
 	return sc;
 }
@@ -801,47 +4268,188 @@ static void *create_corba_config(apr_pool_t *p, __attribute__((unused)) server_r
 /**
  * Merge of of mod_corba's configuration structure.
  */
-static void *merge_corba_config(__attribute__((unused)) apr_pool_t *p, void *base_par,
+static void *merge_corba_config(apr_pool_t *p, void *base_par,
 		void *override_par)
 {
 	corba_conf *base = (corba_conf *) base_par;
 	corba_conf *override = (corba_conf *) override_par;
+	apr_table_t *objects;
 
-	/* we will allow to inherit only ns_loc and objects */
-	apr_table_overlap(base->objects, override->objects,
-			APR_OVERLAP_TABLES_SET);
+	/*
+	 * we will allow to inherit only ns_loc and objects, base table is
+	 * shared by all virtual servers so it must stay untouched; scope and
+	 * exclusions are applied per server in post config hook
+	 */
+	objects = apr_table_copy(p, base->objects);
+	apr_table_overlap(objects, override->objects, APR_OVERLAP_TABLES_SET);
+	override->objects = objects;
+	override->contexts = apr_array_append(p, base->contexts,
+			override->contexts);
 	
     if (override->ns_loc == NULL)
 		override->ns_loc = base->ns_loc;
+	if (override->resolve_threads == 0)
+		override->resolve_threads = base->resolve_threads;
+	if (override->admin_allow == NULL)
+		override->admin_allow = base->admin_allow;
     
     //if (override->ior_cache_enabled == 0)
     //    override->ior_cache_enabled = base->ior_cache_enabled;
-	/* copy of orb is useless since it is NULL for sure */
 
 	return override;
 }
 
 
+/**
+ * Cleanup routine releases current generation of IOR cache.
+ *
+ * This routine is called upon destroying child pool (which is at child
+ * exit).
+ *
+ * @param data  The cache.
+ */
+static apr_status_t ior_cache_cleanup(void *data)
+{
+    cache_t *child_cache = data;
+
+    cache = NULL;
+    ior_gen_unref(child_cache->current);
+    return APR_SUCCESS;
+}
+
+/**
+ * Function creates ORB of child and registers its cleanup with child pool,
+ * so the ORB is torn down on child exit. Nothing of ORB state is shared with
+ * parent process.
+ *
+ * @param p     Child pool.
+ * @param s     Server record.
+ * @return      1 if successfull, 0 in case of failure.
+ */
+static int corba_orb_init(apr_pool_t *p, server_rec *s)
+{
+	CORBA_Environment	ev[1];
+	int orb_argc = 2;
+	char *orb_argv[] = {"dummy", "--GIOPTimeoutMSEC=0", NULL};
+
+	CORBA_exception_init(ev);
+
+    /* create orb object */
+#if APR_HAS_THREADS
+	/* objects are resolved from several threads concurrently */
+	orb = CORBA_ORB_init(&orb_argc, orb_argv, "orbit-local-mt-orb", ev);
+#else
+	orb = CORBA_ORB_init(&orb_argc, orb_argv, "orbit-local-orb", ev);
+#endif
+	if (raised_exception(ev)) {
+		ap_log_error(APLOG_MARK, APLOG_CRIT, 0, s,
+			"mod_corba: could not create ORB: %s.", ev->_id);
+		CORBA_exception_free(ev);
+		orb = NULL;
+		return 0;
+	}
+	/* register cleanup for ORB */
+	apr_pool_cleanup_register(p, orb, corba_cleanup,
+			apr_pool_cleanup_null);
+	ap_log_error(APLOG_MARK, APLOG_DEBUG, 0, s,
+			"mod_corba: child ORB initialized");
+	return 1;
+}
+
 /**
  * Child init function
  */
 static void corba_child_init(apr_pool_t *p, server_rec *s) {
+    server_rec  *vs;
+    corba_conf  *sc;
+
+    /* ORB is needed only if some server uses the module */
+    for (vs = s; vs != NULL; vs = vs->next) {
+        sc = (corba_conf *) ap_get_module_config(vs->module_config,
+                &corba_module);
+        if (sc->enabled)
+            break;
+    }
+    if (vs == NULL)
+        return;
+
+    limits_child_init(s);
+    apr_pool_cleanup_register(p, NULL, limits_cleanup, apr_pool_cleanup_null);
+    if (!corba_orb_init(p, s))
+        return;
+
     cache = apr_palloc(p, sizeof(cache_t));
     
-    if (apr_pool_create(&cache->pool, p) != APR_SUCCESS) {
+    if ((cache->current = ior_gen_create()) == NULL) {
         cache = NULL;
         return;
     }
+    apr_pool_cleanup_register(p, cache, ior_cache_cleanup,
+            apr_pool_cleanup_null);
 
-    cache->iors = apr_table_make(cache->pool, 5);
+    cache->generation = 0;
+    cache->flushes = 0;
+    memset(cache->alias_generation, 0, sizeof(cache->alias_generation));
+    if (shared != NULL) {
+        /* flushes requested before child was started do not matter */
+        int i;
+
+        cache->generation = apr_atomic_read32(&shared->generation);
+        cache->flushes = apr_atomic_read32(&shared->flushes);
+        for (i = 0; i < FLUSH_SLOTS; i++)
+            cache->alias_generation[i] =
+                apr_atomic_read32(&shared->alias_generation[i]);
+    }
+    if (apr_pool_create(&cache->health_pool, p) != APR_SUCCESS) {
+        cache = NULL;
+        return;
+    }
+    cache->health = apr_hash_make(cache->health_pool);
+    cache->probe_alias = NULL;
+    cache->probe_ior = NULL;
+    cache->probe_failed = 0;
+    cache->probe_timeout = 0;
+    cache->inflight = apr_hash_make(p);
+    cache->inflight_contexts = apr_hash_make(p);
+    cache->fills_dropped = 0;
+    cache->file_pool = NULL;
+    cache->file_iors = NULL;
+    if (apr_pool_create(&cache->backend_pool, p) != APR_SUCCESS) {
+        cache = NULL;
+        return;
+    }
+    cache->backends = apr_hash_make(cache->backend_pool);
+    cache->sockets = 0;
+    cache->other_calls = apr_array_make(cache->backend_pool, 4,
+            sizeof(ORBitConnection *));
 #if APR_HAS_THREADS
     if (apr_thread_mutex_create(&(cache->mutex), 
             APR_THREAD_MUTEX_DEFAULT, p) != APR_SUCCESS) {
         
         ap_log_error(APLOG_MARK, APLOG_ERR, 0, s,
-            "failed create child cache mutex.");
+            "failed create child cache mutex, IOR cache disabled.");
+        cache = NULL;
+        return;
+    }
+    if (apr_thread_cond_create(&cache->filled, p) != APR_SUCCESS) {
+        ap_log_error(APLOG_MARK, APLOG_ERR, 0, s,
+            "failed create child cache condition, IOR cache disabled.");
+        cache = NULL;
+        return;
     }
+
+    /* liveness prober is configured globally */
+    sc = (corba_conf *) ap_get_module_config(s->module_config, &corba_module);
+    if (sc->probe_interval > 0)
+        corba_prober_start(p, s, sc);
+    if (sc->idle_timeout > 0)
+        corba_reaper_start(p, s, sc);
 #endif
+
+    /* IOR file is configured globally */
+    sc = (corba_conf *) ap_get_module_config(s->module_config, &corba_module);
+    if (sc->ior_file != NULL)
+        corba_watcher_start(p, s, sc);
     ap_log_error(APLOG_MARK, APLOG_DEBUG, 0, s,
             "child initialized.");
 }
@@ -854,8 +4462,16 @@ static void register_hooks(__attribute__((unused)) apr_pool_t *p)
 {
 	ap_hook_post_config(corba_postconfig_hook, NULL, NULL, APR_HOOK_MIDDLE);
 	ap_hook_child_init(corba_child_init, NULL, NULL, APR_HOOK_MIDDLE);
+	ap_hook_pre_connection(corba_pre_connection, NULL, NULL, APR_HOOK_MIDDLE);
     ap_hook_process_connection(corba_process_connection, NULL, NULL,
 			APR_HOOK_MIDDLE);
+	ap_hook_handler(corba_admin_handler, NULL, NULL, APR_HOOK_MIDDLE);
+	ap_hook_monitor(corba_monitor, NULL, NULL, APR_HOOK_MIDDLE);
+	APR_REGISTER_OPTIONAL_FN(corba_object_alive);
+	APR_REGISTER_OPTIONAL_FN(corba_call_record);
+	APR_REGISTER_OPTIONAL_FN(corba_connection_objects);
+	APR_REGISTER_OPTIONAL_FN(corba_call_begin);
+	APR_REGISTER_OPTIONAL_FN(corba_call_end);
 }
 
 /**
@@ -0,0 +1,108 @@
+/*
+ * Copyright (C) 2026  CZ.NIC, z. s. p. o.
+ *
+ * This file is part of FRED.
+ *
+ * FRED is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * FRED is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with FRED.  If not, see <https://www.gnu.org/licenses/>.
+ */
+/**
+ * @file mod_corba.h
+ *
+ * Interface of mod_corba for other modules.
+ *
+ * Functions are exported as apache optional functions, other modules
+ * retrieve them by APR_RETRIEVE_OPTIONAL_FN() and must cope with their
+ * absence (older mod_corba).
+ */
+#ifndef MOD_CORBA_H_5A1F0C3E9B7D4E21A6C8F04D2B93E716
+#define MOD_CORBA_H_5A1F0C3E9B7D4E21A6C8F04D2B93E716
+
+#include "httpd.h"
+#include "apr_hash.h"
+#include "apr_optional.h"
+#include "apr_time.h"
+
+/**
+ * Returns health of object given by alias as seen by the last background
+ * liveness probe in current child (see CorbaProbeInterval). Object whose
+ * probe is in progress longer than CorbaProbeTimeout is dead.
+ *
+ * @param alias   Alias of object.
+ * @return        1 if object is alive, 0 if it is dead, -1 if it was not
+ *                probed yet.
+ */
+APR_DECLARE_OPTIONAL_FN(int, corba_object_alive, (const char *alias));
+
+/**
+ * Records one call of remote object in counters of calls shared by all
+ * children, which are printed by corba-admin handler. Modules record calls
+ * they make through references obtained from mod_corba, e.g.:
+ *
+ * @code
+ * start = apr_time_now();
+ * ret = ccReg_EPP_ClientLogin(service, ..., ev);
+ * record("EPP", "ClientLogin", apr_time_now() - start,
+ *        ev->_major != CORBA_NO_EXCEPTION);
+ * @endcode
+ *
+ * @param alias      Alias of object.
+ * @param operation  Name of operation.
+ * @param elapsed    Duration of call.
+ * @param exception  Nonzero if the call raised exception.
+ */
+APR_DECLARE_OPTIONAL_FN(void, corba_call_record, (const char *alias,
+        const char *operation, apr_interval_time_t elapsed, int exception));
+
+/**
+ * Returns object references of connection (hash table alias - reference).
+ * The references are also bound to connection's conn_config, but only
+ * this function waits for acquisition started in pre_connection hook when
+ * CorbaEarlyAcquire is enabled. Modules should call it as late as possible,
+ * i.e. just before the first call of remote object.
+ *
+ * @param c       Connection.
+ * @return        Hash table of object references, NULL if there is none.
+ */
+APR_DECLARE_OPTIONAL_FN(apr_hash_t *, corba_connection_objects,
+        (conn_rec *c));
+
+/**
+ * Asks for admission of call of object whose concurrent calls are limited
+ * by CorbaMaxConcurrent in all children. If the limit is reached, the call
+ * waits for admission at most CorbaQueueTimeout, or it is rejected at once
+ * when too many calls are waiting. Rejected call should not be made, the
+ * module should report temporary unavailability of the service instead.
+ * Calls of objects without limit are always admitted. GIOP connection of
+ * the object is not closed by CorbaGIOPIdleTimeout while the call is in
+ * flight.
+ *
+ * @param alias    Alias of object.
+ * @param object   Reference of object which is called (as returned by
+ *                 corba_connection_objects()).
+ * @return         1 if the call was admitted and must be finished by
+ *                 corba_call_end(), 0 if it was rejected.
+ */
+APR_DECLARE_OPTIONAL_FN(int, corba_call_begin, (const char *alias,
+        void *object));
+
+/**
+ * Finishes call admitted by corba_call_begin().
+ *
+ * @param alias    Alias of object.
+ * @param object   Reference of object which was called.
+ */
+APR_DECLARE_OPTIONAL_FN(void, corba_call_end, (const char *alias,
+        void *object));
+
+#endif
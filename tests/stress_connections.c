@@ -0,0 +1,917 @@
+/*
+ * Copyright (C) 2026  CZ.NIC, z. s. p. o.
+ *
+ * This file is part of FRED.
+ *
+ * FRED is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * FRED is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with FRED.  If not, see <https://www.gnu.org/licenses/>.
+ */
+/**
+ * @file stress_connections.c
+ *
+ * Concurrency stress test of connection handling of mod_corba.
+ *
+ * The module is compiled into the test together with minimal replacements
+ * of apache functions it uses (httpd 2.4 API). Many threads open
+ * connections through the pre_connection and process_connection hooks of
+ * the module, while a fake nameservice running in a separate process goes
+ * down, comes back, answers slowly and returns changed IORs, and the IOR
+ * cache is flushed through the corba-admin handler.
+ *
+ * The test fails if a connection blocks longer than STRESS_MAX_BLOCK_MSEC
+ * (environment, default 5000), if the cache lock is waited for longer than
+ * a second, if any object reference, backend reference, GIOP socket or
+ * admission of limited object is left behind once all connections are
+ * closed, or if a connection does not get all objects after the nameservice
+ * recovers.
+ * STRESS_VERBOSE in environment turns on logging of the module.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "mod_corba.c"
+
+#include <fcntl.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+
+/** Number of threads opening connections. */
+#define STRESS_THREADS          32
+/** Duration of one phase of nameservice behaviour (msec). */
+#define STRESS_PHASE_MSEC       1500
+/** Default of longest acceptable duration of connection setup (msec). */
+#define STRESS_MAX_BLOCK_MSEC   5000
+/** Longest acceptable wait for cache lock (msec). */
+#define STRESS_MAX_LOCK_MSEC    1000
+/** Delay of every call of slow nameservice (msec). */
+#define STRESS_SLOW_MSEC        100
+/** Context of objects of fake nameservice. */
+#define FAKE_CONTEXT            "fred"
+
+/** Objects bound in context of fake nameservice. */
+static const char * const fake_objects[] = {
+    "EPP", "WhoisIntf", "Admin", "Logger", "Mifd", "Accounting"
+};
+
+/** Number of objects bound in context of fake nameservice. */
+#define FAKE_OBJECTS    ((int) (sizeof fake_objects / sizeof fake_objects[0]))
+
+/** References of connection: objects of context and explicit "Log". */
+#define STRESS_REFERENCES   (FAKE_OBJECTS + 1)
+
+/**
+ * Behaviour of fake nameservice, shared by the test and the fake process.
+ */
+typedef struct {
+    volatile int        ready;      /**< Pid of fake once it is listening. */
+    volatile int        delay;      /**< Every call is delayed (msec). */
+    volatile int        version;    /**< Objects get new IORs on change. */
+    volatile unsigned   calls;      /**< Calls answered by fake. */
+} fake_control_t;
+
+static fake_control_t *control;
+
+/*
+ * Replacements of apache functions used by the module.
+ */
+
+/** Log level of module messages printed by the test. */
+static int stress_log_level = APLOG_CRIT;
+
+static void stress_log(int level, apr_status_t status, const char *fmt,
+        va_list ap)
+{
+    char    buf[256];
+
+    if ((level & APLOG_LEVELMASK) > stress_log_level)
+        return;
+    vfprintf(stderr, fmt, ap);
+    if (status != APR_SUCCESS)
+        fprintf(stderr, ": %s", apr_strerror(status, buf, sizeof buf));
+    fputc('\n', stderr);
+}
+
+void ap_log_error_(__attribute__((unused)) const char *file,
+        __attribute__((unused)) int line,
+        __attribute__((unused)) int module_index, int level,
+        apr_status_t status, __attribute__((unused)) const server_rec *s,
+        const char *fmt, ...)
+{
+    va_list ap;
+
+    va_start(ap, fmt);
+    stress_log(level, status, fmt, ap);
+    va_end(ap);
+}
+
+void ap_log_cerror_(__attribute__((unused)) const char *file,
+        __attribute__((unused)) int line,
+        __attribute__((unused)) int module_index, int level,
+        apr_status_t status, __attribute__((unused)) const conn_rec *c,
+        const char *fmt, ...)
+{
+    va_list ap;
+
+    va_start(ap, fmt);
+    stress_log(level, status, fmt, ap);
+    va_end(ap);
+}
+
+void ap_log_rerror_(__attribute__((unused)) const char *file,
+        __attribute__((unused)) int line,
+        __attribute__((unused)) int module_index, int level,
+        apr_status_t status, __attribute__((unused)) const request_rec *r,
+        const char *fmt, ...)
+{
+    va_list ap;
+
+    va_start(ap, fmt);
+    stress_log(level, status, fmt, ap);
+    va_end(ap);
+}
+
+int ap_rprintf(__attribute__((unused)) request_rec *r,
+        __attribute__((unused)) const char *fmt, ...)
+{
+    return 0;
+}
+
+void ap_set_content_type(__attribute__((unused)) request_rec *r,
+        __attribute__((unused)) const char *ct)
+{
+}
+
+int ap_discard_request_body(__attribute__((unused)) request_rec *r)
+{
+    return OK;
+}
+
+const char *ap_check_cmd_context(__attribute__((unused)) cmd_parms *cmd,
+        __attribute__((unused)) unsigned forbidden)
+{
+    return NULL;
+}
+
+char *ap_server_root_relative(apr_pool_t *p, const char *fname)
+{
+    return apr_pstrdup(p, fname);
+}
+
+void ap_hook_post_config(__attribute__((unused)) ap_HOOK_post_config_t *pf,
+        __attribute__((unused)) const char * const *aszPre,
+        __attribute__((unused)) const char * const *aszSucc,
+        __attribute__((unused)) int nOrder)
+{
+}
+
+void ap_hook_child_init(__attribute__((unused)) ap_HOOK_child_init_t *pf,
+        __attribute__((unused)) const char * const *aszPre,
+        __attribute__((unused)) const char * const *aszSucc,
+        __attribute__((unused)) int nOrder)
+{
+}
+
+void ap_hook_pre_connection(
+        __attribute__((unused)) ap_HOOK_pre_connection_t *pf,
+        __attribute__((unused)) const char * const *aszPre,
+        __attribute__((unused)) const char * const *aszSucc,
+        __attribute__((unused)) int nOrder)
+{
+}
+
+void ap_hook_process_connection(
+        __attribute__((unused)) ap_HOOK_process_connection_t *pf,
+        __attribute__((unused)) const char * const *aszPre,
+        __attribute__((unused)) const char * const *aszSucc,
+        __attribute__((unused)) int nOrder)
+{
+}
+
+void ap_hook_handler(__attribute__((unused)) ap_HOOK_handler_t *pf,
+        __attribute__((unused)) const char * const *aszPre,
+        __attribute__((unused)) const char * const *aszSucc,
+        __attribute__((unused)) int nOrder)
+{
+}
+
+void ap_hook_monitor(__attribute__((unused)) ap_HOOK_monitor_t *pf,
+        __attribute__((unused)) const char * const *aszPre,
+        __attribute__((unused)) const char * const *aszSucc,
+        __attribute__((unused)) int nOrder)
+{
+}
+
+/*
+ * Fake nameservice. It runs in its own process, so that it can really go
+ * down, and serves context FAKE_CONTEXT with objects fake_objects. Bound
+ * objects are contexts themselves, the module never calls them.
+ */
+
+/**
+ * Servant of fake naming context.
+ */
+typedef struct {
+    POA_CosNaming_NamingContext servant;    /**< Servant (must be first). */
+} fake_servant_t;
+
+static PortableServer_POA   fake_poa;
+static CORBA_Object         fake_context;
+static CORBA_Object         fake_refs[FAKE_OBJECTS];
+static int                  fake_version = -1;
+
+static CORBA_Object fake_resolve(PortableServer_Servant servant,
+        const CosNaming_Name *n, CORBA_Environment *ev);
+static void fake_list(PortableServer_Servant servant,
+        const CORBA_unsigned_long how_many, CosNaming_BindingList **bl,
+        CosNaming_BindingIterator *bi, CORBA_Environment *ev);
+
+static PortableServer_ServantBase__epv fake_base_epv = {
+    ._private = NULL
+};
+
+static POA_CosNaming_NamingContext__epv fake_epv = {
+    ._private = NULL,
+    .resolve  = fake_resolve,
+    .list     = fake_list
+};
+
+static POA_CosNaming_NamingContext__vepv fake_vepv = {
+    ._base_epv                   = &fake_base_epv,
+    .CosNaming_NamingContext_epv = &fake_epv
+};
+
+/**
+ * Function activates new fake context and returns its reference.
+ */
+static CORBA_Object fake_activate(CORBA_Environment *ev)
+{
+    fake_servant_t          *servant = calloc(1, sizeof *servant);
+    PortableServer_ObjectId *oid;
+
+    servant->servant.vepv = &fake_vepv;
+    POA_CosNaming_NamingContext__init((PortableServer_Servant) servant, ev);
+    if (raised_exception(ev))
+        return CORBA_OBJECT_NIL;
+    oid = PortableServer_POA_activate_object(fake_poa, servant, ev);
+    if (raised_exception(ev))
+        return CORBA_OBJECT_NIL;
+    CORBA_free(oid);
+    return PortableServer_POA_servant_to_reference(fake_poa, servant, ev);
+}
+
+/**
+ * Function delays call of fake as requested by the test and activates new
+ * objects (with new IORs) when the version was changed.
+ */
+static void fake_call(CORBA_Environment *ev)
+{
+    int version = control->version;
+    int delay   = control->delay;
+    int i;
+
+    control->calls++;
+    if (delay > 0)
+        usleep(delay * 1000);
+    if (version == fake_version)
+        return;
+    for (i = 0; i < FAKE_OBJECTS; i++) {
+        if (fake_refs[i] != CORBA_OBJECT_NIL)
+            CORBA_Object_release(fake_refs[i], ev);
+        fake_refs[i] = fake_activate(ev);
+    }
+    fake_version = version;
+}
+
+static CORBA_Object fake_resolve(__attribute__((unused)) PortableServer_Servant servant,
+        const CosNaming_Name *n, CORBA_Environment *ev)
+{
+    CosNaming_NamingContext_NotFound *ex;
+    int i;
+
+    fake_call(ev);
+    if (n->_length >= 1 && strcmp(n->_buffer[0].id, FAKE_CONTEXT) == 0) {
+        if (n->_length == 1)
+            return CORBA_Object_duplicate(fake_context, ev);
+        for (i = 0; n->_length == 2 && i < FAKE_OBJECTS; i++) {
+            if (strcmp(n->_buffer[1].id, fake_objects[i]) == 0)
+                return CORBA_Object_duplicate(fake_refs[i], ev);
+        }
+    }
+    ex = CosNaming_NamingContext_NotFound__alloc();
+    ex->why = CosNaming_NamingContext_missing_node;
+    ex->rest_of_name._maximum = ex->rest_of_name._length = 0;
+    ex->rest_of_name._buffer  = NULL;
+    ex->rest_of_name._release = CORBA_FALSE;
+    CORBA_exception_set(ev, CORBA_USER_EXCEPTION,
+            ex_CosNaming_NamingContext_NotFound, ex);
+    return CORBA_OBJECT_NIL;
+}
+
+static void fake_list(__attribute__((unused)) PortableServer_Servant servant,
+        __attribute__((unused)) const CORBA_unsigned_long how_many,
+        CosNaming_BindingList **bl, CosNaming_BindingIterator *bi,
+        CORBA_Environment *ev)
+{
+    CosNaming_BindingList *list;
+    int i;
+
+    fake_call(ev);
+    list = CosNaming_BindingList__alloc();
+    list->_maximum = list->_length = FAKE_OBJECTS;
+    list->_buffer  = CosNaming_BindingList_allocbuf(FAKE_OBJECTS);
+    CORBA_sequence_set_release(list, CORBA_TRUE);
+    for (i = 0; i < FAKE_OBJECTS; i++) {
+        CosNaming_Binding *b = &list->_buffer[i];
+
+        b->binding_type = CosNaming_nobject;
+        b->binding_name._maximum = b->binding_name._length = 1;
+        b->binding_name._buffer  = CosNaming_Name_allocbuf(1);
+        CORBA_sequence_set_release(&b->binding_name, CORBA_TRUE);
+        b->binding_name._buffer[0].id   = CORBA_string_dup(fake_objects[i]);
+        b->binding_name._buffer[0].kind = CORBA_string_dup("Object");
+    }
+    *bl = list;
+    *bi = CORBA_OBJECT_NIL;
+}
+
+/**
+ * Main function of fake nameservice process.
+ *
+ * @param port          Port to listen on.
+ * @param control_path  File with control structure.
+ * @return              Exit status.
+ */
+static int fake_nameservice(const char *port, const char *control_path)
+{
+    CORBA_Environment           ev[1];
+    CORBA_ORB                   forb;
+    CORBA_Object                root;
+    PortableServer_POAManager   mgr;
+    CORBA_sequence_CORBA_octet  okey;
+    char                        sock[64];
+    char                       *argv[] = { "fake-nameservice",
+        "--ORBIIOPIPv4=1", "--ORBIIOPUSock=0", "--ORBIIOPIPName=127.0.0.1",
+        sock, NULL };
+    int                         argc = 5;
+    int                         fd;
+
+    if ((fd = open(control_path, O_RDWR)) < 0)
+        return 1;
+    control = mmap(NULL, sizeof *control, PROT_READ | PROT_WRITE,
+            MAP_SHARED, fd, 0);
+    close(fd);
+    if (control == MAP_FAILED)
+        return 1;
+    snprintf(sock, sizeof sock, "--ORBIIOPIPSock=%s", port);
+
+    CORBA_exception_init(ev);
+    forb = CORBA_ORB_init(&argc, argv, "orbit-local-orb", ev);
+    if (raised_exception(ev))
+        return 1;
+    fake_poa = (PortableServer_POA)
+        CORBA_ORB_resolve_initial_references(forb, "RootPOA", ev);
+    if (raised_exception(ev))
+        return 1;
+    root = fake_activate(ev);
+    fake_context = fake_activate(ev);
+    fake_call(ev);
+    if (root == CORBA_OBJECT_NIL || fake_context == CORBA_OBJECT_NIL)
+        return 1;
+
+    /* answer corbaloc::host:port/NameService */
+    okey._length  = okey._maximum = strlen("NameService");
+    okey._buffer  = (CORBA_octet *) "NameService";
+    okey._release = CORBA_FALSE;
+    ORBit_ORB_forw_bind(forb, &okey, root, ev);
+    mgr = PortableServer_POA__get_the_POAManager(fake_poa, ev);
+    PortableServer_POAManager_activate(mgr, ev);
+    if (raised_exception(ev))
+        return 1;
+
+    control->calls = 0;
+    control->ready = getpid();
+    CORBA_ORB_run(forb, ev);
+    return 0;
+}
+
+/**
+ * Fake nameservice as seen by the test.
+ */
+typedef struct {
+    pid_t           pid;            /**< Pid of fake process, 0 if down. */
+    char            port[16];       /**< Port of fake. */
+    const char     *control_path;   /**< File with control structure. */
+} fake_t;
+
+/**
+ * Function starts fake nameservice and waits until it listens.
+ *
+ * @return  1 if successfull, 0 in case of failure.
+ */
+static int fake_start(fake_t *fake)
+{
+    apr_time_t  deadline = apr_time_now() + apr_time_from_sec(5);
+
+    control->ready = 0;
+    fake->pid = fork();
+    if (fake->pid < 0) {
+        fake->pid = 0;
+        return 0;
+    }
+    if (fake->pid == 0) {
+        execl("/proc/self/exe", "stress_connections", "--fake-nameservice",
+                fake->port, fake->control_path, (char *) NULL);
+        _exit(127);
+    }
+    while (control->ready != fake->pid) {
+        if (apr_time_now() > deadline ||
+            waitpid(fake->pid, NULL, WNOHANG) == fake->pid) {
+            kill(fake->pid, SIGKILL);
+            waitpid(fake->pid, NULL, 0);
+            fake->pid = 0;
+            return 0;
+        }
+        apr_sleep(apr_time_from_msec(10));
+    }
+    return 1;
+}
+
+/**
+ * Function kills fake nameservice.
+ */
+static void fake_stop(fake_t *fake)
+{
+    if (fake->pid == 0)
+        return;
+    kill(fake->pid, SIGKILL);
+    waitpid(fake->pid, NULL, 0);
+    fake->pid = 0;
+}
+
+/**
+ * Function finds free port for fake nameservice.
+ */
+static int fake_port(fake_t *fake)
+{
+    struct sockaddr_in  addr;
+    socklen_t           len = sizeof addr;
+    int                 fd;
+
+    if ((fd = socket(AF_INET, SOCK_STREAM, 0)) < 0)
+        return 0;
+    memset(&addr, 0, sizeof addr);
+    addr.sin_family      = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(fd, (struct sockaddr *) &addr, sizeof addr) != 0 ||
+        getsockname(fd, (struct sockaddr *) &addr, &len) != 0) {
+        close(fd);
+        return 0;
+    }
+    close(fd);
+    snprintf(fake->port, sizeof fake->port, "%u", ntohs(addr.sin_port));
+    return 1;
+}
+
+/*
+ * Connections.
+ */
+
+/**
+ * Thread opening connections until the test ends.
+ */
+typedef struct {
+    apr_pool_t         *pool;       /**< Pool of thread (own allocator). */
+    apr_thread_t       *thread;     /**< Thread. */
+    apr_array_header_t *latencies;  /**< Durations of connection setup. */
+    int                 complete;   /**< Connections with all references. */
+    int                 partial;    /**< Connections missing references. */
+} worker_t;
+
+static server_rec              *servers[2];
+static volatile apr_uint32_t    stop;
+static volatile apr_uint32_t    conn_ids;
+
+/**
+ * Function sets up one connection as apache would, calls all objects the
+ * connection got and closes it.
+ *
+ * @param pool  Pool of connection.
+ * @param s     Server of connection.
+ * @param id    Id of connection.
+ * @return      Number of references connection got.
+ */
+static int stress_connection(apr_pool_t *pool, server_rec *s, long id)
+{
+    conn_rec           *c = apr_pcalloc(pool, sizeof *c);
+    apr_hash_t         *objects;
+    apr_hash_index_t   *hi;
+
+    c->pool        = pool;
+    c->base_server = s;
+    c->id          = id;
+    c->conn_config = apr_pcalloc(pool, sizeof(void *));
+#if AP_MODULE_MAGIC_AT_LEAST(20111130, 0)
+    c->log         = &s->log;
+#endif
+
+    corba_pre_connection(c, NULL);
+    corba_process_connection(c);
+    objects = corba_connection_objects(c);
+    if (objects == NULL)
+        return 0;
+    for (hi = apr_hash_first(pool, objects); hi; hi = apr_hash_next(hi)) {
+        const void *alias;
+        void       *object;
+
+        apr_hash_this(hi, &alias, NULL, &object);
+        if (corba_call_begin(alias, object))
+            corba_call_end(alias, object);
+    }
+    return apr_hash_count(objects);
+}
+
+static void * APR_THREAD_FUNC worker_thread(apr_thread_t *thd, void *data)
+{
+    worker_t       *w = data;
+    apr_pool_t     *cpool;
+    apr_time_t      start;
+    apr_uint32_t    id;
+
+    while (!apr_atomic_read32(&stop)) {
+        if (apr_pool_create(&cpool, w->pool) != APR_SUCCESS)
+            break;
+        id    = apr_atomic_inc32(&conn_ids);
+        start = apr_time_now();
+        if (stress_connection(cpool, servers[id % 2], id) == STRESS_REFERENCES)
+            w->complete++;
+        else
+            w->partial++;
+        apr_pool_destroy(cpool);
+        APR_ARRAY_PUSH(w->latencies, apr_interval_time_t) =
+            apr_time_now() - start;
+    }
+    apr_thread_exit(thd, APR_SUCCESS);
+    return NULL;
+}
+
+/**
+ * Function sends request to corba-admin handler.
+ *
+ * @param pool  Pool of request.
+ * @param s     Server.
+ * @param ip    Address of client.
+ * @param args  Query string of POST request.
+ * @return      Status of handler.
+ */
+static int stress_admin(apr_pool_t *pool, server_rec *s, const char *ip,
+        const char *args)
+{
+    request_rec    *r = apr_pcalloc(pool, sizeof *r);
+    conn_rec       *c = apr_pcalloc(pool, sizeof *c);
+    apr_sockaddr_t *addr;
+
+    if (apr_sockaddr_info_get(&addr, ip, APR_INET, 80, 0, pool) != APR_SUCCESS)
+        return HTTP_INTERNAL_SERVER_ERROR;
+    c->pool        = pool;
+    c->base_server = s;
+#if AP_MODULE_MAGIC_AT_LEAST(20111130, 0)
+    c->log         = &s->log;
+    c->client_addr = addr;
+    r->useragent_addr = addr;
+#else
+    c->remote_addr = addr;
+#endif
+    r->pool          = pool;
+    r->connection    = c;
+    r->server        = s;
+    r->handler       = "corba-admin";
+    r->method        = "POST";
+    r->method_number = M_POST;
+    r->args          = apr_pstrdup(pool, args);
+    r->header_only   = 1;
+    return corba_admin_handler(r);
+}
+
+/**
+ * Function configures server as apache would when reading configuration.
+ */
+static server_rec *stress_server(apr_pool_t *p, process_rec *process,
+        server_rec *base)
+{
+    server_rec     *s = apr_pcalloc(p, sizeof *s);
+    corba_conf     *sc;
+
+    s->process       = process;
+    s->is_virtual    = (base != NULL);
+    s->module_config = apr_pcalloc(p, sizeof(void *));
+#if AP_MODULE_MAGIC_AT_LEAST(20111130, 0)
+    s->log.level     = APLOG_WARNING;
+#else
+    s->loglevel      = APLOG_WARNING;
+#endif
+    sc = create_corba_config(p, s);
+    ap_set_module_config(s->module_config, &corba_module, sc);
+    if (base != NULL)
+        base->next = s;
+    return s;
+}
+
+/**
+ * Phase of behaviour of fake nameservice.
+ */
+struct stress_phase {
+    const char     *name;       /**< Name of phase. */
+    int             down;       /**< Nameservice is killed. */
+    int             delay;      /**< Delay of every call (msec). */
+    int             change;     /**< Objects get new IORs. */
+    const char     *flush;      /**< Query string of flush request or NULL. */
+};
+
+static const struct stress_phase phases[] = {
+    { "up",         0, 0,                0, NULL },
+    { "slow",       0, STRESS_SLOW_MSEC, 0, "flush" },
+    { "down",       1, 0,                0, "flush" },
+    { "restarted",  0, 0,                0, "flush" },
+    { "changed",    0, 0,                1, "flush=EPP,Logger" },
+    { "slow-flush", 0, STRESS_SLOW_MSEC, 1, "flush=" FAKE_CONTEXT },
+    { "recovered",  0, 0,                0, "flush" },
+};
+
+static int failures;
+
+/** Records failed assertion. */
+#define STRESS_CHECK(cond, ...) \
+    do { if (!(cond)) { fprintf(stderr, "FAIL: " __VA_ARGS__); \
+        fputc('\n', stderr); failures++; } } while (0)
+
+static int latency_cmp(const void *a, const void *b)
+{
+    apr_interval_time_t x = *(const apr_interval_time_t *) a;
+    apr_interval_time_t y = *(const apr_interval_time_t *) b;
+
+    return (x > y) - (x < y);
+}
+
+int main(int argc, const char * const argv[])
+{
+    apr_pool_t         *pconf, *pchild, *ptemp;
+    process_rec         process;
+    server_rec         *s;
+    cmd_parms           cmd;
+    worker_t            workers[STRESS_THREADS];
+    apr_array_header_t *all;
+    apr_interval_time_t max_block;
+    apr_hash_index_t   *hi;
+    fake_t              fake;
+    char                control_path[] = "/tmp/stress_connections.XXXXXX";
+    const char         *env;
+    unsigned            p;
+    int                 complete = 0, partial = 0;
+    int                 fd, i;
+
+    if (argc == 4 && strcmp(argv[1], "--fake-nameservice") == 0)
+        return fake_nameservice(argv[2], argv[3]);
+
+    apr_app_initialize(&argc, &argv, NULL);
+    if (getenv("STRESS_VERBOSE") != NULL)
+        stress_log_level = APLOG_DEBUG;
+    env = getenv("STRESS_MAX_BLOCK_MSEC");
+    max_block = apr_time_from_msec(env ? atoi(env) : STRESS_MAX_BLOCK_MSEC);
+
+    /* fake nameservice */
+    if ((fd = mkstemp(control_path)) < 0 ||
+        ftruncate(fd, sizeof *control) != 0) {
+        perror("control file");
+        return 1;
+    }
+    control = mmap(NULL, sizeof *control, PROT_READ | PROT_WRITE,
+            MAP_SHARED, fd, 0);
+    close(fd);
+    if (control == MAP_FAILED) {
+        perror("mmap");
+        return 1;
+    }
+    memset(control, 0, sizeof *control);
+    fake.pid = 0;
+    fake.control_path = control_path;
+    if (!fake_port(&fake) || !fake_start(&fake)) {
+        fprintf(stderr, "could not start fake nameservice\n");
+        unlink(control_path);
+        return 1;
+    }
+
+    /* configuration: main server and virtual server with early acquire */
+    apr_pool_create(&pconf, NULL);
+    apr_pool_create(&ptemp, pconf);
+    process.pool = pconf;
+    corba_module.module_index = 0;
+    s = stress_server(pconf, &process, NULL);
+    servers[0] = s;
+    memset(&cmd, 0, sizeof cmd);
+    cmd.server    = s;
+    cmd.pool      = pconf;
+    cmd.temp_pool = ptemp;
+    set_corba(&cmd, NULL, 1);
+    set_nameservice(&cmd, NULL, apr_pstrcat(pconf, "127.0.0.1:", fake.port,
+                NULL));
+    set_object(&cmd, NULL, FAKE_CONTEXT ".Logger", "Log");
+    set_object_context(&cmd, NULL, FAKE_CONTEXT ".*");
+    set_probe_interval(&cmd, NULL, "1");
+    set_idle_timeout(&cmd, NULL, "1");
+    set_max_concurrent(&cmd, NULL, "EPP", "4", "16");
+    cmd.server = stress_server(pconf, &process, s);
+    servers[1] = cmd.server;
+    set_corba(&cmd, NULL, 1);
+    set_early_acquire(&cmd, NULL, 1);
+    ap_set_module_config(servers[1]->module_config, &corba_module,
+            merge_corba_config(pconf,
+                ap_get_module_config(s->module_config, &corba_module),
+                ap_get_module_config(servers[1]->module_config,
+                    &corba_module)));
+
+    register_hooks(pconf);
+    corba_postconfig_hook(pconf, pconf, ptemp, s);
+    if (shared == NULL) {
+        fprintf(stderr, "shared memory of module not created\n");
+        fake_stop(&fake);
+        unlink(control_path);
+        return 1;
+    }
+
+    /* child */
+    apr_pool_create(&pchild, pconf);
+    corba_child_init(pchild, s);
+    if (cache == NULL) {
+        fprintf(stderr, "child of module not initialized\n");
+        fake_stop(&fake);
+        unlink(control_path);
+        return 1;
+    }
+    STRESS_CHECK(stress_admin(ptemp, s, "192.0.2.1", "flush") ==
+            HTTP_FORBIDDEN, "corba-admin allowed to remote client");
+
+    for (i = 0; i < STRESS_THREADS; i++) {
+        worker_t *w = &workers[i];
+
+        w->complete = w->partial = 0;
+        if (apr_pool_create_unmanaged_ex(&w->pool, NULL, NULL) !=
+                APR_SUCCESS) {
+            fprintf(stderr, "could not create pool of thread\n");
+            return 1;
+        }
+        w->latencies = apr_array_make(w->pool, 1024,
+                sizeof(apr_interval_time_t));
+        if (apr_thread_create(&w->thread, NULL, worker_thread, w, w->pool) !=
+                APR_SUCCESS) {
+            fprintf(stderr, "could not start thread\n");
+            return 1;
+        }
+    }
+
+    /* nameservice flaps while connections are opened */
+    for (p = 0; p < sizeof phases / sizeof phases[0]; p++) {
+        const struct stress_phase *phase = &phases[p];
+
+        fprintf(stderr, "phase %s\n", phase->name);
+        if (phase->down)
+            fake_stop(&fake);
+        else if (fake.pid == 0)
+            STRESS_CHECK(fake_start(&fake), "fake nameservice not restarted");
+        control->delay = phase->delay;
+        if (phase->change)
+            control->version++;
+        if (phase->flush != NULL)
+            STRESS_CHECK(stress_admin(ptemp, s, "127.0.0.1", phase->flush) ==
+                    OK, "flush '%s' refused", phase->flush);
+        apr_sleep(apr_time_from_msec(STRESS_PHASE_MSEC));
+    }
+
+    apr_atomic_set32(&stop, 1);
+    all = apr_array_make(pconf, 4096, sizeof(apr_interval_time_t));
+    for (i = 0; i < STRESS_THREADS; i++) {
+        apr_status_t rv;
+
+        apr_thread_join(&rv, workers[i].thread);
+        complete += workers[i].complete;
+        partial  += workers[i].partial;
+        apr_array_cat(all, workers[i].latencies);
+        apr_pool_destroy(workers[i].pool);
+    }
+
+    /* results */
+    qsort(all->elts, all->nelts, sizeof(apr_interval_time_t), latency_cmp);
+    if (all->nelts > 0) {
+        apr_interval_time_t *lat = (apr_interval_time_t *) all->elts;
+
+        fprintf(stderr, "connections: %d complete, %d partial\n"
+                "setup: p50 %" APR_TIME_T_FMT " us, p99 %" APR_TIME_T_FMT
+                " us, max %" APR_TIME_T_FMT " us\n"
+                "cache lock wait max: %u us\n"
+                "fills: %u, resolves: %u (%u failed), nameservice calls: %u\n",
+                complete, partial, lat[all->nelts / 2],
+                lat[all->nelts * 99 / 100], lat[all->nelts - 1],
+                apr_atomic_read32(&shared->stats.lock_wait_max),
+                apr_atomic_read32(&shared->stats.fills),
+                apr_atomic_read32(&shared->stats.resolves),
+                apr_atomic_read32(&shared->stats.resolve_errors),
+                control->calls);
+        STRESS_CHECK(lat[all->nelts - 1] <= max_block,
+                "connection blocked for %" APR_TIME_T_FMT " us",
+                lat[all->nelts - 1]);
+    }
+    STRESS_CHECK(complete > 0, "no connection got all references");
+    STRESS_CHECK(apr_atomic_read32(&shared->stats.lock_wait_max) <=
+            STRESS_MAX_LOCK_MSEC * 1000, "cache lock waited for too long");
+
+    /* nothing may be left behind by closed connections */
+    STRESS_CHECK(apr_atomic_read32(&shared->stats.references) == 0,
+            "%u object references leaked",
+            apr_atomic_read32(&shared->stats.references));
+    cache_lock();
+    for (hi = apr_hash_first(pconf, cache->backends); hi;
+            hi = apr_hash_next(hi)) {
+        void       *val;
+        backend_t  *b;
+
+        apr_hash_this(hi, NULL, NULL, &val);
+        b = val;
+        STRESS_CHECK(b->refs == 0 && b->inflight == 0,
+                "backend '%s' has %u references, %u calls left",
+                b->alias, b->refs, b->inflight);
+    }
+    STRESS_CHECK(cache->sockets == 0 && cache->other_calls->nelts == 0,
+            "%d sockets, %d other calls left", cache->sockets,
+            cache->other_calls->nelts);
+    cache_unlock();
+    for (i = 0; i < LIMIT_SLOTS; i++) {
+        STRESS_CHECK(apr_atomic_read32(&shared->limits[i].active) == 0 &&
+                apr_atomic_read32(&shared->limits[i].sockets) == 0 &&
+                apr_atomic_read32(&admissions->held[i]) == 0 &&
+                apr_atomic_read32(&admissions->sockets[i]) == 0,
+                "admissions of '%s' left", shared->limits[i].alias);
+    }
+
+    /* parent reclaims admissions of child which died */
+    {
+        limit_t        *lim = apr_hash_get(limits, "EPP", APR_HASH_KEY_STRING);
+        admissions_t   *dead = &shared->children[CHILD_SLOTS - 1];
+        pid_t           pid = fork();
+
+        if (pid == 0)
+            _exit(0);
+        waitpid(pid, NULL, 0);
+        apr_atomic_set32(&dead->held[lim - shared->limits], 2);
+        apr_atomic_add32(&lim->active, 2);
+        apr_atomic_set32(&dead->sockets[lim - shared->limits], 1);
+        apr_atomic_inc32(&lim->sockets);
+        apr_atomic_set32(&dead->pid, pid);
+        corba_monitor(pconf, s);
+        STRESS_CHECK(apr_atomic_read32(&lim->active) == 0 &&
+                apr_atomic_read32(&lim->sockets) == 0 &&
+                apr_atomic_read32(&dead->pid) == 0,
+                "admissions of dead child not reclaimed");
+    }
+
+    /* recovered nameservice serves all objects */
+    for (i = 0; i < 2; i++) {
+        apr_pool_t *cpool;
+
+        apr_pool_create(&cpool, pconf);
+        STRESS_CHECK(stress_connection(cpool, servers[i], 0) ==
+                STRESS_REFERENCES, "server %d incomplete after recovery", i);
+        apr_pool_destroy(cpool);
+    }
+    STRESS_CHECK(apr_atomic_read32(&shared->stats.references) == 0,
+            "object references leaked after recovery");
+
+    /* child exit */
+    apr_pool_destroy(pchild);
+    fake_stop(&fake);
+    unlink(control_path);
+    apr_pool_destroy(pconf);
+    apr_terminate();
+
+    fprintf(stderr, "%s\n", failures ? "FAILED" : "PASSED");
+    return failures ? 1 : 0;
+}